@@ -0,0 +1,262 @@
+#include <stdio.h>       // Standardowe wejście/wyjście (printf, perror)
+#include <stdlib.h>      // Standardowe funkcje ogólnego przeznaczenia (exit)
+#include <string.h>      // Funkcje do manipulacji stringami (memset, strncpy, strncmp)
+#include <unistd.h>      // Funkcje POSIX (close, read)
+#include <time.h>        // Pomiar czasu (clock_gettime)
+#include <sys/socket.h>  // Podstawowe definicje funkcji gniazd
+#include <sys/un.h>      // Definicje adresów gniazd AF_UNIX
+#include <netinet/in.h>  // Definicje struktur adresów internetowych
+#include <arpa/inet.h>   // Funkcje do konwersji adresów IP
+#include <errno.h>       // Dla stałej EINTR
+
+#include "config.h"      // Konfiguracja uruchomieniowa (wspólna z serwerem)
+#include "common_defs.h" // Wartości domyślne wspólne z serwerem
+
+// Program porównujący opóźnienia dostępnych transportów (TCP oraz AF_UNIX) w dwóch pomiarach:
+//   PING   - pojedyncza wymiana PING -> PONG (sam transport, bez logiki serwera),
+//   ZADANIE - pełny cykl zadania widziany przez workera:
+//             GET_TASKS 1 -> GRANT + TASK, RESULT -> OK.
+// Zadania do pomiaru są zgłaszane (SUBMIT) poza mierzonym czasem. Różnica między pomiarami
+// to czas obsługi zadania przez serwer, na który wybór transportu nie ma wpływu.
+// Serwer nie usuwa zadań z puli, więc liczba cykli zadania jest ograniczona jej wolnymi miejscami (POOL).
+
+#define BUFFER_SIZE DEFAULT_BUFFER_SIZE
+#define DEFAULT_ITERATIONS 1000 // Domyślna liczba pomiarów na transport
+#define ENV_PREFIX "WM_BENCH_"  // Prefiks zmiennych środowiskowych (np. WM_BENCH_PORT)
+
+// Ustawienia programu (wartości domyślne poniżej).
+typedef struct {
+    char host[64];         // Adres IP serwera
+    int port;              // Port serwera
+    char unix_socket[108]; // Ścieżka gniazda AF_UNIX ("" - wg portu)
+    int iterations;        // Liczba pomiarów na transport
+} BenchConfig;
+
+static BenchConfig config = {
+    .host = DEFAULT_HOST,
+    .port = DEFAULT_PORT,
+    .unix_socket = "",
+    .iterations = DEFAULT_ITERATIONS,
+};
+
+static ConfigOption bench_options[] = {
+    { "host", CFG_STRING, config.host, sizeof(config.host), 0, 0, 0, "adres IP serwera (pomiar TCP)", 0 },
+    { "port", CFG_INT, &config.port, 0, 1, 65535, 0, "port serwera", 0 },
+    { "unix_socket", CFG_STRING, config.unix_socket, sizeof(config.unix_socket), 0, 0, 0, "ścieżka gniazda AF_UNIX (puste - wg portu)", 0 },
+    { "iterations", CFG_INT, &config.iterations, 0, 1, 10000000, 0, "liczba pomiarów na transport", 0 },
+};
+#define NUM_BENCH_OPTIONS ((int)(sizeof(bench_options) / sizeof(bench_options[0])))
+
+// Odczytuje jedną linię (do znaku '\n') z deskryptora. Zwraca liczbę bajtów, 0 lub -1.
+static ssize_t read_line(int fd, char *buffer, size_t n) {
+    size_t totRead = 0;
+    char ch;
+
+    while (totRead < n - 1) {
+        ssize_t numRead = read(fd, &ch, 1);
+        if (numRead == -1) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        } else if (numRead == 0) {
+            break;
+        }
+        buffer[totRead++] = ch;
+        if (ch == '\n')
+            break;
+    }
+    buffer[totRead] = '\0';
+    return totRead;
+}
+
+// Nawiązuje połączenie TCP z serwerem. Zwraca deskryptor lub -1.
+static int connect_tcp(const char *host, int port) {
+    struct sockaddr_in serv_addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[BENCH] socket");
+        return -1;
+    }
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &serv_addr.sin_addr) <= 0) {
+        printf("[BENCH] Niepoprawny adres serwera: '%s'\n", host);
+        close(fd);
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("[BENCH] connect tcp");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Nawiązuje połączenie z serwerem przez gniazdo AF_UNIX. Zwraca deskryptor lub -1.
+static int connect_unix(const char *path) {
+    struct sockaddr_un serv_addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[BENCH] unix socket");
+        return -1;
+    }
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    snprintf(serv_addr.sun_path, sizeof(serv_addr.sun_path), "%s", path);
+    if (connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("[BENCH] connect unix");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Zwraca bieżący czas monotoniczny w mikrosekundach.
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Wysyła żądanie i odczytuje jednolinijkową odpowiedź. Zwraca 0, jeśli zaczyna się od expected, -1 w przeciwnym razie.
+static int exchange(int fd, const char *request, char *reply, const char *expected) {
+    if (send(fd, request, strlen(request), 0) < 0) {
+        perror("[BENCH] send");
+        return -1;
+    }
+    if (read_line(fd, reply, BUFFER_SIZE) <= 0 || strncmp(reply, expected, strlen(expected)) != 0) {
+        printf("[BENCH] Nieoczekiwana odpowiedź serwera na '%.*s': '%s'\n", (int)strcspn(request, "\n"), request, reply);
+        return -1;
+    }
+    return 0;
+}
+
+// Jedna wymiana PING -> PONG. Zwraca czas w us lub -1 (błąd).
+static double measure_ping(int fd) {
+    char buffer[BUFFER_SIZE];
+    double start = now_us();
+    if (exchange(fd, "PING\n", buffer, "PONG") < 0) {
+        return -1;
+    }
+    return now_us() - start;
+}
+
+// Jeden pełny cykl zadania: zgłoszenie (poza pomiarem), dzierżawa i odesłanie wyniku.
+// Zwraca czas w us lub -1 (błąd).
+static double measure_task(int fd) {
+    char buffer[BUFFER_SIZE];
+    int granted, credit, task_id;
+    unsigned int epoch;
+
+    if (exchange(fd, "SUBMIT ADD 1 2\n", buffer, "OK ") < 0) {
+        return -1;
+    }
+    double start = now_us();
+    if (exchange(fd, "GET_TASKS 1\n", buffer, "GRANT ") < 0) {
+        return -1;
+    }
+    if (sscanf(buffer, "GRANT %d %d", &granted, &credit) != 2 || granted != 1) {
+        printf("[BENCH] Serwer nie przydzielił zadania: '%s'\n", buffer);
+        return -1;
+    }
+    if (read_line(fd, buffer, BUFFER_SIZE) <= 0 || sscanf(buffer, "TASK %d %u", &task_id, &epoch) != 2) {
+        printf("[BENCH] Nieoczekiwana linia zadania: '%s'\n", buffer);
+        return -1;
+    }
+    char request[64];
+    snprintf(request, sizeof(request), "RESULT %d %u 3\n", task_id, epoch);
+    if (exchange(fd, request, buffer, "OK ") < 0) {
+        return -1;
+    }
+    return now_us() - start;
+}
+
+// Pyta serwer o liczbę wolnych miejsc w puli zadań. Zwraca ją lub -1 (błąd).
+static int query_free_slots(int fd) {
+    char buffer[BUFFER_SIZE];
+    int free_slots, capacity;
+    if (exchange(fd, "POOL\n", buffer, "POOL ") < 0 || sscanf(buffer, "POOL %d %d", &free_slots, &capacity) != 2) {
+        return -1;
+    }
+    return free_slots;
+}
+
+// Wykonuje serię pomiarów na danym połączeniu i wypisuje statystyki.
+// Zwraca 0 (sukces) lub -1 (błąd).
+static int run_bench(const char *transport, const char *name, int fd, int iterations, double (*measure)(int)) {
+    double total = 0, min = -1, max = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        double elapsed = measure(fd);
+        if (elapsed < 0) {
+            printf("[BENCH] %s %s: przerwano po %d iteracjach.\n", transport, name, i);
+            return -1;
+        }
+        total += elapsed;
+        if (min < 0 || elapsed < min) min = elapsed;
+        if (elapsed > max) max = elapsed;
+    }
+    printf("[BENCH] %-8s %-8s iteracji: %d  śr: %8.2f us  min: %8.2f us  max: %8.2f us\n",
+           transport, name, iterations, total / iterations, min, max);
+    return 0;
+}
+
+// Wykonuje oba pomiary na danym transporcie. Wolne miejsca puli są dzielone po równo
+// między ten i pozostałe transporty (transports_left). Zwraca 0 (sukces) lub -1 (błąd).
+static int bench_transport(const char *transport, int fd, int iterations, int transports_left) {
+    if (fd < 0) {
+        return -1;
+    }
+    int failed = run_bench(transport, "PING", fd, iterations, measure_ping) < 0;
+    int free_slots = failed ? -1 : query_free_slots(fd);
+    if (free_slots < 0) {
+        failed = 1;
+    } else {
+        int task_iterations = free_slots / transports_left < iterations ? free_slots / transports_left : iterations;
+        if (task_iterations == 0) {
+            printf("[BENCH] %-8s ZADANIE  pominięto: brak wolnych miejsc w puli zadań serwera.\n", transport);
+        } else {
+            if (task_iterations < iterations) {
+                printf("[BENCH] %-8s ZADANIE  ograniczono do %d iteracji (wolne miejsca w puli zadań: %d).\n",
+                       transport, task_iterations, free_slots);
+            }
+            failed = run_bench(transport, "ZADANIE", fd, task_iterations, measure_task) < 0;
+        }
+    }
+    close(fd);
+    return failed ? -1 : 0;
+}
+
+// Użycie: ./bench [--<ustawienie> wartość]... (np. --iterations 2000 --port 8081)
+// Kolejność źródeł ustawień: wiersz poleceń > zmienne WM_BENCH_* > wartości domyślne.
+// Pomiar zadań zgłasza najwyżej 2 * iterations zadań, ale nie więcej, niż ma wolnych miejsc pula serwera.
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    if (CFG_load_env(bench_options, NUM_BENCH_OPTIONS, ENV_PREFIX) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc &&
+            CFG_set(bench_options, NUM_BENCH_OPTIONS, argv[i] + 2, argv[i + 1], CFG_SOURCE_CLI) == 0) {
+            i++;
+        } else {
+            fprintf(stderr, "Użycie: %s [--<ustawienie> wartość]...\n", argv[0]);
+            fprintf(stderr, "Ustawienia (także w zmiennych %s<KLUCZ>):\n", ENV_PREFIX);
+            CFG_print_usage(bench_options, NUM_BENCH_OPTIONS);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (config.unix_socket[0] == '\0') {
+        snprintf(config.unix_socket, sizeof(config.unix_socket), UNIX_SOCKET_PATH_FMT, config.port);
+    }
+
+    if (bench_transport("TCP", connect_tcp(config.host, config.port), config.iterations, 2) < 0) {
+        failed = 1;
+    }
+    if (bench_transport("AF_UNIX", connect_unix(config.unix_socket), config.iterations, 1) < 0) {
+        failed = 1;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "cluster_manager.h" // Nagłówek modułu
+#include "common_defs.h"     // Definicje ogólne
+
+// Opis węzła klastra.
+typedef struct {
+    char host[64]; // Adres IP węzła
+    int port;      // Port węzła
+    int fd;        // Połączenie wychodzące do węzła (-1 jeśli brak, zawsze -1 dla własnego węzła)
+    long long down_until_ms; // Węzeł jest pomijany do tej chwili po błędzie (0 - dostępny)
+    int late_replies;        // Liczba spóźnionych odpowiedzi (po przekroczeniu czasu) do pominięcia
+} ClusterNode;
+
+// Punkt na pierścieniu spójnego haszowania.
+typedef struct {
+    uint32_t hash; // Pozycja na pierścieniu
+    int node;      // Indeks węzła w tablicy nodes
+} RingPoint;
+
+// --- Zmienne globalne modułu ---
+static ClusterNode nodes[CLUSTER_MAX_NODES]; // Wszystkie węzły klastra (łącznie z własnym)
+static int num_nodes = 0;
+static int self_idx = 0;                     // Indeks własnego węzła w tablicy nodes
+static RingPoint ring[CLUSTER_MAX_NODES * CLUSTER_VNODES];
+static int ring_size = 0;
+
+// Domyślna funkcja oczekiwania na peera (tylko jego gniazdo).
+static int wait_socket(int fd, short events, int timeout_ms);
+static CM_wait_fn wait_fn = wait_socket; // Funkcja oczekiwania (CM_set_wait_function)
+
+// --- Funkcje pomocnicze ---
+
+// Funkcja skrótu FNV-1a (32 bity).
+static uint32_t fnv1a(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Zwraca bieżący czas monotoniczny w milisekundach.
+static long long now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int wait_socket(int fd, short events, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = events };
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready < 0 && errno == EINTR) {
+        return 1; // Sygnał - wywołujący ponownie sprawdzi gniazdo i pozostały czas
+    }
+    return ready;
+}
+
+// Porównanie punktów pierścienia dla qsort().
+static int compare_points(const void *a, const void *b) {
+    uint32_t ha = ((const RingPoint *)a)->hash;
+    uint32_t hb = ((const RingPoint *)b)->hash;
+    return (ha > hb) - (ha < hb);
+}
+
+// Zwraca indeks węzła będącego właścicielem danej pozycji na pierścieniu.
+static int owner_of_hash(uint32_t hash) {
+    if (ring_size == 0) {
+        return self_idx;
+    }
+    // Wyszukiwanie binarne pierwszego punktu o hash >= podanego (z zawinięciem pierścienia)
+    int lo = 0, hi = ring_size;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ring[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return ring[lo == ring_size ? 0 : lo].node;
+}
+
+// Zwraca indeks węzła będącego właścicielem zadania o danym ID.
+static int owner_of_task_id(int task_id) {
+    return owner_of_hash(fnv1a(&task_id, sizeof(task_id)));
+}
+
+// Parsuje opis węzła "host:port" lub "port" (host domyślny: adres tego węzła).
+// Zwraca 0 (sukces) lub -1 (błąd).
+static int parse_node(const char *spec, ClusterNode *node) {
+    const char *colon = strrchr(spec, ':');
+    const char *port_str = spec;
+    if (colon != NULL) {
+        size_t host_len = colon - spec;
+        if (host_len == 0 || host_len >= sizeof(node->host)) {
+            return -1;
+        }
+        memcpy(node->host, spec, host_len);
+        node->host[host_len] = '\0';
+        port_str = colon + 1;
+    } else {
+        snprintf(node->host, sizeof(node->host), "%s", nodes[self_idx].host);
+    }
+    node->port = atoi(port_str);
+    node->fd = -1;
+    node->down_until_ms = 0;
+    node->late_replies = 0;
+    return (node->port > 0 && node->port < 65536) ? 0 : -1;
+}
+
+// Zamyka połączenie wychodzące do węzła (np. po błędzie lub przekroczeniu czasu).
+static void drop_connection(int node) {
+    if (nodes[node].fd != -1) {
+        close(nodes[node].fd);
+        nodes[node].fd = -1;
+        nodes[node].late_replies = 0;
+    }
+}
+
+// Oznacza węzeł jako niedostępny na peer_retry_ms - kolejne żądania do niego są od razu odrzucane,
+// więc martwy peer nie zatrzymuje obsługi workerów przy każdym przejmowaniu zadań.
+static void mark_down(int node) {
+    if (server_config.peer_retry_ms > 0) {
+        nodes[node].down_until_ms = now_ms() + server_config.peer_retry_ms;
+        printf("[CM] Węzeł %s:%d pomijany przez %d ms.\n", nodes[node].host, nodes[node].port, server_config.peer_retry_ms);
+    }
+}
+
+// Ustawia limit czasu send() na peer_timeout_ms - pełny bufor zablokowanego peera nie zatrzyma
+// pętli poll(). Odpowiedź jest oczekiwana przez wait_fn z własnym terminem (patrz peer_request).
+static void set_send_timeout(int fd) {
+    struct timeval tv;
+    tv.tv_sec = server_config.peer_timeout_ms / 1000;
+    tv.tv_usec = (server_config.peer_timeout_ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// Zwraca połączenie do węzła, nawiązując je w razie potrzeby. Zwraca -1 przy błędzie.
+// connect() nie blokuje - nawiązanie połączenia jest oczekiwane przez wait_fn (z limitem
+// peer_timeout_ms), więc w tym czasie obsługiwane są żądania innych węzłów.
+static int get_connection(int node) {
+    if (nodes[node].fd != -1) {
+        return nodes[node].fd;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[CM] socket");
+        return -1;
+    }
+    set_send_timeout(fd);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(nodes[node].port);
+    int connected = 0;
+    if (inet_pton(AF_INET, nodes[node].host, &address.sin_addr) > 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            connected = 1;
+        } else if (errno == EINPROGRESS) {
+            long long deadline = now_ms() + server_config.peer_timeout_ms;
+            long long remaining;
+            while (!connected && (remaining = deadline - now_ms()) > 0 && wait_fn(fd, POLLOUT, (int)remaining) >= 0) {
+                struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+                if (poll(&pfd, 1, 0) <= 0) {
+                    continue; // Jeszcze w toku (np. przerwanie sygnałem)
+                }
+                int error = 0;
+                socklen_t len = sizeof(error);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+                    break;
+                }
+                connected = 1;
+            }
+        }
+        fcntl(fd, F_SETFL, 0); // Dalsze send() blokujące z limitem SO_SNDTIMEO
+    }
+    if (!connected) {
+        printf("[CM] Nie można połączyć się z węzłem %s:%d.\n", nodes[node].host, nodes[node].port);
+        close(fd);
+        mark_down(node);
+        return -1;
+    }
+    printf("[CM] Połączono z węzłem %s:%d.\n", nodes[node].host, nodes[node].port);
+    nodes[node].fd = fd;
+    return fd;
+}
+
+// Pomija spóźnioną odpowiedź na żądanie, którego czas oczekiwania minął. Zadanie przydzielone
+// w spóźnionej odpowiedzi na PEER_STEAL jest zwracane właścicielowi.
+// Zwraca 1, jeśli wysłano PEER_REQUEUE (jego odpowiedź nadejdzie po odpowiedzi na bieżące żądanie).
+static int discard_late_reply(int node, const char *line) {
+    int task_id;
+    unsigned int epoch;
+    if (sscanf(line, "TASK %d %u", &task_id, &epoch) == 2) {
+        char request[64];
+        snprintf(request, sizeof(request), "PEER_REQUEUE %d %u\n", task_id, epoch);
+        printf("[CM] Zwrócono zadanie %d ze spóźnionej odpowiedzi węzła %s:%d.\n", task_id, nodes[node].host, nodes[node].port);
+        return send(nodes[node].fd, request, strlen(request), MSG_NOSIGNAL) > 0;
+    }
+    return 0;
+}
+
+// Wysyła żądanie (zakończone '\n') do węzła i odczytuje jednolinijkową odpowiedź (bez '\n').
+// Odpowiedź jest oczekiwana przez wait_fn, która w tym czasie może obsługiwać żądania
+// innych węzłów - dwa węzły wysyłające do siebie żądania jednocześnie nie czekają na siebie
+// nawzajem do upływu limitu czasu. Po przekroczeniu czasu połączenie pozostaje otwarte
+// (właściciel wiąże z nim zadania przejęte przez ten węzeł - zamknięcie spowodowałoby ich
+// ponowne wykonanie), a spóźniona odpowiedź jest pomijana przy kolejnym żądaniu.
+// Połączenie jest zamykane tylko po błędzie gniazda lub rozłączeniu peera.
+// Zwraca 0 (sukces) lub -1 (błąd).
+static int peer_request(int node, const char *request, char *reply, int reply_size) {
+    if (now_ms() < nodes[node].down_until_ms) {
+        return -1; // Węzeł niedawno niedostępny - pominięcie bez oczekiwania
+    }
+    int fd = get_connection(node);
+    if (fd == -1) {
+        return -1;
+    }
+    if (send(fd, request, strlen(request), MSG_NOSIGNAL) < 0) {
+        perror("[CM] send to peer");
+        drop_connection(node);
+        mark_down(node);
+        return -1;
+    }
+
+    long long deadline = now_ms() + server_config.peer_timeout_ms;
+    int requeued = 0; // Odpowiedzi na PEER_REQUEUE wysłane przy pomijaniu - po bieżącej odpowiedzi
+    int total = 0;
+    char ch;
+    for (;;) {
+        ssize_t n = recv(fd, &ch, 1, MSG_DONTWAIT);
+        if (n == 1) {
+            if (ch != '\n') {
+                if (total < reply_size - 1) {
+                    reply[total++] = ch;
+                }
+                continue;
+            }
+            reply[total] = '\0';
+            if (nodes[node].late_replies == 0) {
+                nodes[node].late_replies = requeued;
+                return 0;
+            }
+            nodes[node].late_replies--;
+            requeued += discard_late_reply(node, reply);
+            total = 0;
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            long long remaining = deadline - now_ms();
+            if (remaining > 0 && wait_fn(fd, POLLIN, (int)remaining) >= 0) {
+                continue; // Gotowe do odczytu lub ponowne sprawdzenie terminu
+            }
+            printf("[CM] Brak odpowiedzi od węzła %s:%d w czasie %d ms.\n", nodes[node].host, nodes[node].port, server_config.peer_timeout_ms);
+            nodes[node].late_replies += 1 + requeued;
+            mark_down(node);
+            return -1;
+        }
+        printf("[CM] Węzeł %s:%d zamknął połączenie.\n", nodes[node].host, nodes[node].port);
+        drop_connection(node);
+        mark_down(node);
+        return -1;
+    }
+}
+
+// --- Implementacja funkcji modułu ---
+
+// Ustawienie funkcji oczekiwania na odpowiedzi peerów.
+void CM_set_wait_function(CM_wait_fn fn) {
+    wait_fn = fn != NULL ? fn : wait_socket;
+}
+
+// Inicjalizacja klastra i budowa pierścienia.
+int CM_init(const char *self_host, int self_port, char *peer_specs[], int num_peers) {
+    if (num_peers + 1 > CLUSTER_MAX_NODES) {
+        fprintf(stderr, "[CM] Zbyt wielu peerów (maksymalnie %d).\n", CLUSTER_MAX_NODES - 1);
+        return -1;
+    }
+
+    num_nodes = 0;
+    self_idx = 0;
+    snprintf(nodes[0].host, sizeof(nodes[0].host), "%s", self_host);
+    nodes[0].port = self_port;
+    nodes[0].fd = -1;
+    nodes[0].down_until_ms = 0;
+    nodes[0].late_replies = 0;
+    num_nodes = 1;
+    for (int i = 0; i < num_peers; i++) {
+        if (parse_node(peer_specs[i], &nodes[num_nodes]) < 0) {
+            fprintf(stderr, "[CM] Niepoprawny adres peera: '%s'\n", peer_specs[i]);
+            return -1;
+        }
+        num_nodes++;
+    }
+
+    // Węzły wirtualne: pozycje zależą wyłącznie od "host:port#i", więc każdy węzeł
+    // buduje identyczny pierścień niezależnie od kolejności podania peerów.
+    ring_size = 0;
+    for (int n = 0; n < num_nodes; n++) {
+        for (int v = 0; v < CLUSTER_VNODES; v++) {
+            char name[96];
+            int len = snprintf(name, sizeof(name), "%s:%d#%d", nodes[n].host, nodes[n].port, v);
+            ring[ring_size].hash = fnv1a(name, len);
+            ring[ring_size].node = n;
+            ring_size++;
+        }
+    }
+    qsort(ring, ring_size, sizeof(RingPoint), compare_points);
+
+    if (num_peers > 0) {
+        printf("[CM] Klaster: węzeł %s:%d, liczba peerów: %d\n", self_host, self_port, num_peers);
+        for (int n = 1; n < num_nodes; n++) {
+            printf("[CM]   peer %s:%d\n", nodes[n].host, nodes[n].port);
+        }
+    }
+    return 0;
+}
+
+// Aktualizacja limitu czasu otwartych połączeń.
+void CM_update_timeouts() {
+    for (int n = 0; n < num_nodes; n++) {
+        if (nodes[n].fd != -1) {
+            set_send_timeout(nodes[n].fd);
+        }
+    }
+}
+
+// Zamknięcie połączeń do peerów.
+void CM_cleanup() {
+    for (int n = 0; n < num_nodes; n++) {
+        drop_connection(n);
+    }
+}
+
+int CM_is_enabled() {
+    return num_nodes > 1;
+}
+
+int CM_owns_task_id(int task_id) {
+    return owner_of_task_id(task_id) == self_idx;
+}
+
+int CM_owns_key(const char *key) {
+    return owner_of_hash(fnv1a(key, strlen(key))) == self_idx;
+}
+
+// Przekazanie zgłoszenia do właściciela klucza.
+int CM_forward_submit(const char *idempotency_key, const char *description, char *reply, int reply_size) {
+    const char *key = idempotency_key != NULL ? idempotency_key : description;
+    int owner = owner_of_hash(fnv1a(key, strlen(key)));
+    char request[server_config.buffer_size];
+    if (idempotency_key != NULL) {
+        snprintf(request, sizeof(request), "PEER_SUBMIT KEY=%s %s\n", idempotency_key, description);
+    } else {
+        snprintf(request, sizeof(request), "PEER_SUBMIT %s\n", description);
+    }
+    return peer_request(owner, request, reply, reply_size);
+}
+
+// Przejęcie oczekującego zadania od peerów (kolejno, do pierwszego sukcesu).
+int CM_steal_task(int *task_id, unsigned int *epoch, char *description, int description_size) {
+    char reply[server_config.buffer_size];
+    for (int n = 0; n < num_nodes; n++) {
+        if (n == self_idx || peer_request(n, "PEER_STEAL\n", reply, sizeof(reply)) < 0) {
+            continue;
+        }
+        int id, offset = 0;
+        unsigned int lease_epoch;
+        if (sscanf(reply, "TASK %d %u %n", &id, &lease_epoch, &offset) == 2 && offset > 0) {
+            *task_id = id;
+            *epoch = lease_epoch;
+            snprintf(description, description_size, "%s", reply + offset);
+            printf("[CM] Przejęto zadanie %d od węzła %s:%d.\n", id, nodes[n].host, nodes[n].port);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Przekazanie wyniku do właściciela zadania.
+int CM_forward_result(int task_id, unsigned int epoch, const char *result, char *reply, int reply_size) {
+    char request[server_config.buffer_size + 32];
+    snprintf(request, sizeof(request), "PEER_RESULT %d %u %s\n", task_id, epoch, result);
+    return peer_request(owner_of_task_id(task_id), request, reply, reply_size);
+}
+
+// Zwrócenie zadania do kolejki właściciela.
+int CM_forward_requeue(int task_id, unsigned int epoch) {
+    char request[64];
+    char reply[server_config.buffer_size];
+    snprintf(request, sizeof(request), "PEER_REQUEUE %d %u\n", task_id, epoch);
+    return peer_request(owner_of_task_id(task_id), request, reply, sizeof(reply));
+}
+
+// Rozesłanie anulowania zadania do wszystkich peerów.
+int CM_broadcast_cancel(int task_id, char *owner_reply, int reply_size) {
+    char request[64];
+    char reply[server_config.buffer_size];
+    int owner = owner_of_task_id(task_id);
+    int owner_replied = (owner == self_idx);
+    snprintf(request, sizeof(request), "PEER_CANCEL %d\n", task_id);
+    for (int n = 0; n < num_nodes; n++) {
+        if (n == self_idx || peer_request(n, request, reply, sizeof(reply)) < 0) {
+            continue;
+        }
+        if (n == owner) {
+            snprintf(owner_reply, reply_size, "%s", reply);
+            owner_replied = 1;
+        }
+    }
+    return owner_replied ? 0 : -1;
+}
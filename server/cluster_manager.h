@@ -0,0 +1,65 @@
+#ifndef CLUSTER_MANAGER_H
+#define CLUSTER_MANAGER_H
+
+// Interfejs modułu klastra serwerów.
+// Węzły dzielą przestrzeń ID zadań za pomocą spójnego haszowania (pierścień z węzłami wirtualnymi).
+// Każdy węzeł nadaje wyłącznie ID, których jest właścicielem, więc właściciela zadania
+// można wyznaczyć z samego ID. Komunikacja między węzłami odbywa się przez zwykły port
+// serwera za pomocą komend PEER_* (żądanie-odpowiedź, z limitem czasu).
+
+// Inicjuje klaster: adres tego węzła oraz lista peerów w formacie "host:port" lub "port".
+// Przy braku peerów klaster jest wyłączony, a węzeł jest właścicielem wszystkich zadań.
+// Zwraca 0 (sukces) lub -1 (błąd konfiguracji).
+int CM_init(const char *self_host, int self_port, char *peer_specs[], int num_peers);
+
+// Funkcja oczekiwania na peera: czeka co najwyżej timeout_ms na zdarzenia events (POLLIN - odpowiedź,
+// POLLOUT - nawiązanie połączenia) gniazda fd. Zwraca >0 (gotowe lub warto sprawdzić ponownie),
+// 0 (limit czasu) lub -1 (błąd).
+typedef int (*CM_wait_fn)(int fd, short events, int timeout_ms);
+
+// Ustawia funkcję oczekiwania na peerów (NULL - zwykłe oczekiwanie na gnieździe).
+// Menedżer workerów obsługuje w niej żądania PEER_* przychodzące w trakcie oczekiwania.
+void CM_set_wait_function(CM_wait_fn fn);
+
+// Stosuje bieżący peer_timeout_ms do otwartych połączeń (np. po przeładowaniu konfiguracji).
+void CM_update_timeouts();
+
+// Zamyka połączenia wychodzące do peerów.
+void CM_cleanup();
+
+// Zwraca 1, jeśli skonfigurowano co najmniej jednego peera.
+int CM_is_enabled();
+
+// Zwraca 1, jeśli ten węzeł jest właścicielem zadania o danym ID.
+int CM_owns_task_id(int task_id);
+
+// Zwraca 1, jeśli ten węzeł jest właścicielem zgłoszenia o danym kluczu
+// (klucz idempotencji, a przy jego braku opis zadania).
+int CM_owns_key(const char *key);
+
+// Przekazuje zgłoszenie zadania do węzła-właściciela klucza (PEER_SUBMIT).
+// idempotency_key może być NULL - właściciel jest wtedy wyznaczany z opisu.
+// Zapisuje odpowiedź właściciela (bez '\n') w reply.
+// Zwraca 0 (sukces) lub -1 (właściciel niedostępny).
+int CM_forward_submit(const char *idempotency_key, const char *description, char *reply, int reply_size);
+
+// Próbuje przejąć oczekujące zadanie od kolejnych peerów (PEER_STEAL).
+// Zwraca 1 i wypełnia task_id/epoch/description, jeśli któryś peer oddał zadanie, 0 w przeciwnym razie.
+int CM_steal_task(int *task_id, unsigned int *epoch, char *description, int description_size);
+
+// Przekazuje wynik dzierżawy epoch zadania do jego właściciela (PEER_RESULT).
+// Zapisuje odpowiedź właściciela (bez '\n') w reply.
+// Zwraca 0 (sukces) lub -1 (właściciel niedostępny).
+int CM_forward_result(int task_id, unsigned int epoch, const char *result, char *reply, int reply_size);
+
+// Rozsyła anulowanie zadania do wszystkich peerów (PEER_CANCEL): każdy zwalnia dzierżawy
+// swoich workerów, a właściciel dodatkowo anuluje zadanie w puli.
+// Zapisuje odpowiedź właściciela (bez '\n') w owner_reply, jeśli właścicielem jest peer.
+// Zwraca 0 (właściciel odpowiedział lub jest nim ten węzeł) lub -1 (właściciel niedostępny).
+int CM_broadcast_cancel(int task_id, char *owner_reply, int reply_size);
+
+// Zwraca zadanie do kolejki właściciela (PEER_REQUEUE), np. po rozłączeniu workera.
+// Zwraca 0 (sukces) lub -1 (właściciel niedostępny).
+int CM_forward_requeue(int task_id, unsigned int epoch);
+
+#endif // CLUSTER_MANAGER_H
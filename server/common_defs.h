@@ -1,18 +1,38 @@
 #ifndef COMMON_DEFS_H
 #define COMMON_DEFS_H
 
-// Stałe konfiguracyjne.
-#define PORT 8080             // Port serwera
-#define BUFFER_SIZE 1024      // Rozmiar bufora odczytu/zapisu
-#define INITIAL_CAPACITY 5    // Początkowa pojemność tablic dynamicznych
-#define REALLOC_INCREMENT 5   // Krok zwiększania pojemności tablic
-#define MAX_TOTAL_TASKS 100   // Maksymalna liczba zadań w systemie
+// Domyślne wartości ustawień serwera (nadpisywane przez plik, środowisko i wiersz poleceń - zob. ServerConfig).
+#define DEFAULT_HOST "127.0.0.1"      // Adres węzła w klastrze
+#define DEFAULT_LISTEN_ADDRESS "0.0.0.0" // Adres nasłuchu TCP
+#define DEFAULT_PORT 8080             // Port serwera
+#define UNIX_SOCKET_PATH_FMT "/tmp/worker_manager_%d.sock" // Ścieżka gniazda AF_UNIX (wg portu) dla lokalnych workerów
+#define DEFAULT_LISTEN_BACKLOG 10     // Długość kolejki oczekujących połączeń
+#define DEFAULT_BUFFER_SIZE 1024      // Rozmiar bufora linii protokołu
+#define DEFAULT_INITIAL_CAPACITY 5    // Początkowa pojemność tablic dynamicznych
+#define DEFAULT_REALLOC_INCREMENT 5   // Krok zwiększania pojemności tablic
+#define DEFAULT_MAX_TOTAL_TASKS 100   // Maksymalna liczba zadań w systemie
+#define DEFAULT_PEER_TIMEOUT_MS 500   // Limit czasu żądania do peera
+#define DEFAULT_PEER_RETRY_MS 5000    // Jak długo pomijany jest peer po błędzie połączenia lub braku odpowiedzi
+#define DEFAULT_WORKER_CREDIT 8       // Maksymalne okno kredytowe workera
+#define DEFAULT_LEASE_HORIZON_MS 2000 // Ile pracy (w ms) worker może mieć przydzielone ponad bieżące zadanie
+#define DEFAULT_EWMA_WEIGHT 0.25      // Waga nowej próbki w średnich kroczących
+
+// Stałe klastra.
+#define CLUSTER_MAX_NODES 16         // Maksymalna liczba węzłów (łącznie z własnym)
+#define CLUSTER_VNODES 32            // Liczba węzłów wirtualnych na pierścieniu dla każdego węzła
+
+// Stałe sterowania przepływem (okno kredytowe workera).
+#define MAX_WORKER_CREDIT 8     // Górna granica ustawienia max_worker_credit (rozmiar tablic dzierżaw)
+
+// Stałe zgłaszania zadań.
+#define MAX_IDEMPOTENCY_KEY 128 // Rozmiar bufora klucza idempotencji (klucz do 127 znaków)
 
 // Statusy zadań.
 #define TASK_STATUS_PENDING      0 // Oczekujące
 #define TASK_STATUS_IN_PROGRESS  1 // W trakcie realizacji
 #define TASK_STATUS_COMPLETED    2 // Zakończone
 #define TASK_STATUS_FAILED       3 // Nieudane
+#define TASK_STATUS_CANCELLED    4 // Anulowane
 
 // Statusy workerów.
 #define WORKER_STATUS_IDLE 0 // Dostępny
@@ -23,13 +43,45 @@ typedef struct {
     int id;
     char description[256];
     int status;
+    unsigned int lease_epoch; // Numer ostatniej dzierżawy (token fencingowy), zwiększany przy każdym przydziale
+    int peer_fd;            // Połączenie peera, który przejął zadanie (-1 jeśli brak)
 } Task;
 
 // Struktura informacji o workerze.
 typedef struct {
     int fd;                 // Deskryptor gniazda workera
-    int status;             // Aktualny status workera
-    int current_task_id;    // ID zadania aktualnie przetwarzanego (-1 jeśli brak)
+    int status;             // Aktualny status workera (BUSY, jeśli dzierżawi co najmniej jedno zadanie)
+    int leased_task_ids[MAX_WORKER_CREDIT]; // ID zadań dzierżawionych przez workera
+    unsigned int leased_epochs[MAX_WORKER_CREDIT]; // Numery dzierżaw tych zadań
+    int num_leases;         // Liczba dzierżawionych zadań
+    double avg_service_ms;  // Średnia krocząca czasu obsługi zadania w ms (ważna, gdy has_service_sample)
+    int has_service_sample; // 1 - zmierzono co najmniej jeden czas obsługi
+    double last_event_ms;   // Czas ostatniego wyniku lub przydziału do pustego okna (ms, z ułamkiem)
+    char *inbuf;            // Bufor niekompletnej linii protokołu (buffer_size bajtów)
+    int inbuf_len;          // Liczba bajtów w buforze
+    int is_peer;            // 1 - połączenie od innego węzła klastra (wysłało komendę PEER_*)
 } WorkerInfo;
 
+// Ustawienia serwera. Opis kluczy, zakresy i przeładowanie (SIGHUP) - zob. tablica w main_server.c.
+typedef struct {
+    char host[64];            // Adres węzła w klastrze (identyfikuje węzeł na pierścieniu)
+    char listen_address[64];  // Adres nasłuchu TCP
+    int port;                 // Port TCP
+    char unix_socket[108];    // Ścieżka gniazda AF_UNIX ("" - UNIX_SOCKET_PATH_FMT wg portu)
+    int listen_backlog;       // Długość kolejki oczekujących połączeń
+    char peers[1024];         // Peery klastra: "host:port" lub "port", rozdzielone przecinkami
+    int buffer_size;          // Rozmiar bufora linii protokołu
+    int initial_capacity;     // Początkowa pojemność tablic połączeń
+    int realloc_increment;    // Krok zmiany pojemności tablic połączeń (live)
+    int max_total_tasks;      // Pojemność puli zadań
+    int peer_timeout_ms;      // Limit czasu żądania do peera (live)
+    int peer_retry_ms;        // Czas pomijania niedostępnego peera (live)
+    int max_worker_credit;    // Maksymalne okno kredytowe workera, <= MAX_WORKER_CREDIT (live)
+    int lease_horizon_ms;     // Horyzont dzierżawy (live)
+    double ewma_weight;       // Waga nowej próbki w średnich kroczących (live)
+} ServerConfig;
+
+// Efektywne ustawienia serwera (definicja w main_server.c).
+extern ServerConfig server_config;
+
 #endif // COMMON_DEFS_H
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "config.h" // Nagłówek modułu
+
+// Nazwy źródeł wartości (w kolejności ConfigSource).
+static const char *source_names[] = { "domyślna", "plik", "środowisko", "wiersz poleceń" };
+
+// --- Funkcje pomocnicze ---
+
+// Porównuje klucze, traktując '-' i '_' jako równoważne oraz ignorując wielkość liter.
+static int name_matches(const char *name, const char *key, size_t key_len) {
+    size_t i;
+    for (i = 0; i < key_len && name[i] != '\0'; i++) {
+        char a = name[i] == '-' ? '_' : tolower((unsigned char)name[i]);
+        char b = key[i] == '-' ? '_' : tolower((unsigned char)key[i]);
+        if (a != b) {
+            return 0;
+        }
+    }
+    return i == key_len && name[i] == '\0';
+}
+
+// Zwraca ustawienie o danym kluczu (o długości key_len) lub NULL.
+static ConfigOption *find_option(ConfigOption *options, int num_options, const char *key, size_t key_len) {
+    for (int i = 0; i < num_options; i++) {
+        if (name_matches(options[i].name, key, key_len)) {
+            return &options[i];
+        }
+    }
+    return NULL;
+}
+
+// Zapisuje bieżącą wartość ustawienia jako tekst.
+static void format_value(const ConfigOption *option, char *buffer, int size) {
+    switch (option->type) {
+        case CFG_INT:    snprintf(buffer, size, "%d", *(const int *)option->value); break;
+        case CFG_DOUBLE: snprintf(buffer, size, "%g", *(const double *)option->value); break;
+        case CFG_STRING: snprintf(buffer, size, "%s", (const char *)option->value); break;
+    }
+}
+
+// Sprawdza i przypisuje wartość tekstową do ustawienia. Zwraca 0 (sukces) lub -1 (niepoprawna wartość).
+static int assign_value(ConfigOption *option, const char *text) {
+    char *end;
+    errno = 0;
+    if (option->type == CFG_INT) {
+        long number = strtol(text, &end, 10);
+        if (errno != 0 || end == text || *end != '\0' || number < option->min || number > option->max) {
+            fprintf(stderr, "[CFG] Niepoprawna wartość '%s' dla %s (liczba całkowita z zakresu %g-%g).\n",
+                    text, option->name, option->min, option->max);
+            return -1;
+        }
+        *(int *)option->value = (int)number;
+    } else if (option->type == CFG_DOUBLE) {
+        double number = strtod(text, &end);
+        if (errno != 0 || end == text || *end != '\0' || number < option->min || number > option->max) {
+            fprintf(stderr, "[CFG] Niepoprawna wartość '%s' dla %s (liczba z zakresu %g-%g).\n",
+                    text, option->name, option->min, option->max);
+            return -1;
+        }
+        *(double *)option->value = number;
+    } else {
+        if ((int)strlen(text) >= option->size) {
+            fprintf(stderr, "[CFG] Wartość dla %s jest za długa (maksymalnie %d znaków).\n", option->name, option->size - 1);
+            return -1;
+        }
+        snprintf((char *)option->value, option->size, "%s", text);
+    }
+    return 0;
+}
+
+// Usuwa białe znaki z początku i końca napisu (w miejscu). Zwraca początek napisu.
+static char *trim(char *text) {
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+// Wspólna obsługa pliku konfiguracyjnego przy starcie (reload = 0) i przeładowaniu (reload = 1).
+// Zwraca liczbę zmienionych ustawień lub -1 (błąd przy starcie / brak pliku).
+static int process_file(ConfigOption *options, int num_options, const char *path, int reload) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "[CFG] Nie można otworzyć pliku konfiguracyjnego '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[1024];
+    int line_no = 0;
+    int changed = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0'; // Usunięcie komentarza i końca linii
+        char *key = trim(line);
+        if (*key == '\0') {
+            continue;
+        }
+        char *equals = strchr(key, '=');
+        if (equals == NULL) {
+            fprintf(stderr, "[CFG] %s:%d: oczekiwano 'klucz = wartość'.\n", path, line_no);
+            failed = 1;
+            continue;
+        }
+        *equals = '\0';
+        key = trim(key);
+        char *text = trim(equals + 1);
+
+        ConfigOption *option = find_option(options, num_options, key, strlen(key));
+        if (option == NULL) {
+            fprintf(stderr, "[CFG] %s:%d: nieznany klucz '%s'.\n", path, line_no, key);
+            failed = 1;
+            continue;
+        }
+        if (!reload) {
+            if (assign_value(option, text) < 0) {
+                failed = 1;
+            } else {
+                option->source = CFG_SOURCE_FILE;
+            }
+            continue;
+        }
+
+        // Przeładowanie: porównanie z bieżącą wartością na kopii ustawienia
+        char old_text[1024], new_text[1024];
+        union { int i; double d; char s[1024]; } candidate;
+        ConfigOption probe = *option;
+        probe.value = &candidate;
+        probe.size = option->size < (int)sizeof(candidate.s) ? option->size : (int)sizeof(candidate.s);
+        if (assign_value(&probe, text) < 0) {
+            continue; // Niepoprawna wartość - pozostaje poprzednia
+        }
+        format_value(option, old_text, sizeof(old_text));
+        format_value(&probe, new_text, sizeof(new_text));
+        if (strcmp(old_text, new_text) == 0) {
+            continue;
+        }
+        if (option->source > CFG_SOURCE_FILE) {
+            printf("[CFG] %s: pominięto zmianę (nadpisane przez %s).\n", option->name, source_names[option->source]);
+        } else if (!option->live) {
+            printf("[CFG] %s: zmiana %s -> %s wymaga ponownego uruchomienia.\n", option->name, old_text, new_text);
+        } else {
+            assign_value(option, text);
+            option->source = CFG_SOURCE_FILE;
+            printf("[CFG] %s: %s -> %s\n", option->name, old_text, new_text);
+            changed++;
+        }
+    }
+    fclose(file);
+    return (failed && !reload) ? -1 : changed;
+}
+
+// --- Implementacja funkcji modułu ---
+
+int CFG_set(ConfigOption *options, int num_options, const char *name, const char *value, ConfigSource source) {
+    ConfigOption *option = find_option(options, num_options, name, strlen(name));
+    if (option == NULL) {
+        return -1;
+    }
+    if (assign_value(option, value) < 0) {
+        return -2;
+    }
+    option->source = source;
+    return 0;
+}
+
+int CFG_load_file(ConfigOption *options, int num_options, const char *path) {
+    return process_file(options, num_options, path, 0) < 0 ? -1 : 0;
+}
+
+int CFG_load_env(ConfigOption *options, int num_options, const char *prefix) {
+    int failed = 0;
+    for (int i = 0; i < num_options; i++) {
+        char variable[128];
+        int len = snprintf(variable, sizeof(variable), "%s%s", prefix, options[i].name);
+        for (int c = 0; c < len && c < (int)sizeof(variable) - 1; c++) {
+            variable[c] = variable[c] == '-' ? '_' : toupper((unsigned char)variable[c]);
+        }
+        const char *value = getenv(variable);
+        if (value == NULL) {
+            continue;
+        }
+        if (assign_value(&options[i], value) < 0) {
+            fprintf(stderr, "[CFG] Zmienna środowiskowa %s ma niepoprawną wartość.\n", variable);
+            failed = 1;
+        } else {
+            options[i].source = CFG_SOURCE_ENV;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+int CFG_reload_file(ConfigOption *options, int num_options, const char *path) {
+    return process_file(options, num_options, path, 1);
+}
+
+void CFG_dump(const ConfigOption *options, int num_options, const char *tag) {
+    printf("%s Efektywna konfiguracja:\n", tag);
+    for (int i = 0; i < num_options; i++) {
+        char text[1024];
+        format_value(&options[i], text, sizeof(text));
+        printf("%s   %-20s = %-24s (%s%s)\n", tag, options[i].name, text,
+               source_names[options[i].source], options[i].live ? ", SIGHUP" : "");
+    }
+}
+
+void CFG_print_usage(const ConfigOption *options, int num_options) {
+    for (int i = 0; i < num_options; i++) {
+        char text[1024];
+        format_value(&options[i], text, sizeof(text));
+        fprintf(stderr, "  --%-20s %s (domyślnie: %s)\n", options[i].name, options[i].help, text);
+    }
+}
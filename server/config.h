@@ -0,0 +1,61 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Interfejs modułu konfiguracji uruchomieniowej (wspólny dla serwera i workera).
+// Program opisuje swoje ustawienia tablicą ConfigOption. Wartość ustawienia pochodzi
+// z pierwszego źródła w kolejności: wiersz poleceń (--klucz wartość), zmienna środowiskowa
+// (prefiks + KLUCZ wielkimi literami), plik konfiguracyjny (linie "klucz = wartość",
+// komentarze od '#'), wartość domyślna. W nazwach kluczy '-' i '_' są równoważne.
+
+// Typ wartości ustawienia.
+typedef enum {
+    CFG_INT,
+    CFG_DOUBLE,
+    CFG_STRING
+} ConfigType;
+
+// Źródło bieżącej wartości ustawienia (w kolejności rosnącego priorytetu).
+typedef enum {
+    CFG_SOURCE_DEFAULT,
+    CFG_SOURCE_FILE,
+    CFG_SOURCE_ENV,
+    CFG_SOURCE_CLI
+} ConfigSource;
+
+// Opis jednego ustawienia.
+typedef struct {
+    const char *name;     // Klucz ustawienia (np. "max_total_tasks")
+    ConfigType type;      // Typ wartości
+    void *value;          // Wskaźnik na zmienną: int*, double* lub bufor char[] dla CFG_STRING
+    int size;             // Rozmiar bufora dla CFG_STRING (ignorowany dla pozostałych typów)
+    double min, max;      // Dopuszczalny zakres dla CFG_INT i CFG_DOUBLE
+    int live;             // 1 - ustawienie może zmienić się w trakcie pracy (przeładowanie pliku)
+    const char *help;     // Krótki opis (dla --help i zrzutu konfiguracji)
+    ConfigSource source;  // Źródło bieżącej wartości (ustawiane przez moduł)
+} ConfigOption;
+
+// Ustawia wartość ustawienia o danej nazwie, sprawdzając typ i zakres.
+// Zwraca 0 (sukces), -1 (nieznany klucz) lub -2 (niepoprawna wartość).
+int CFG_set(ConfigOption *options, int num_options, const char *name, const char *value, ConfigSource source);
+
+// Wczytuje plik konfiguracyjny (przy starcie - nadpisuje wszystkie ustawienia).
+// Zwraca 0 (sukces) lub -1 (brak pliku, nieznany klucz lub niepoprawna wartość).
+int CFG_load_file(ConfigOption *options, int num_options, const char *path);
+
+// Wczytuje zmienne środowiskowe prefix + KLUCZ (np. "WM_SERVER_" + "PORT").
+// Zwraca 0 (sukces) lub -1 (niepoprawna wartość).
+int CFG_load_env(ConfigOption *options, int num_options, const char *prefix);
+
+// Ponownie wczytuje plik konfiguracyjny w trakcie pracy (np. po SIGHUP).
+// Zmieniane są tylko ustawienia oznaczone jako live, których nie nadpisano zmienną
+// środowiskową ani opcją wiersza poleceń; pozostałe zmiany są zgłaszane i pomijane.
+// Niepoprawne linie nie przerywają przeładowania. Zwraca liczbę zmienionych ustawień lub -1.
+int CFG_reload_file(ConfigOption *options, int num_options, const char *path);
+
+// Wypisuje efektywne wartości wszystkich ustawień wraz z ich źródłem.
+void CFG_dump(const ConfigOption *options, int num_options, const char *tag);
+
+// Wypisuje listę ustawień (opcje wiersza poleceń) na stderr.
+void CFG_print_usage(const ConfigOption *options, int num_options);
+
+#endif // CONFIG_H
@@ -1,24 +1,183 @@
+#define _GNU_SOURCE // Dla ppoll()
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <poll.h>
+#include <signal.h> // Dla signal(), sigaction(), SIGPIPE i SIGHUP
 #include <errno.h> // Dla errno i EINTR
 
 #include "common_defs.h"    // Definicje ogólne
 #include "task_manager.h"   // Zarządzanie zadaniami
 #include "worker_manager.h" // Zarządzanie workerami
+#include "cluster_manager.h" // Klaster serwerów
+#include "config.h"          // Konfiguracja uruchomieniowa
+
+// Prefiks zmiennych środowiskowych serwera (np. WM_SERVER_PORT, WM_SERVER_CONFIG).
+#define ENV_PREFIX "WM_SERVER_"
+
+// Efektywne ustawienia serwera.
+ServerConfig server_config = {
+    .host = DEFAULT_HOST,
+    .listen_address = DEFAULT_LISTEN_ADDRESS,
+    .port = DEFAULT_PORT,
+    .unix_socket = "",
+    .listen_backlog = DEFAULT_LISTEN_BACKLOG,
+    .peers = "",
+    .buffer_size = DEFAULT_BUFFER_SIZE,
+    .initial_capacity = DEFAULT_INITIAL_CAPACITY,
+    .realloc_increment = DEFAULT_REALLOC_INCREMENT,
+    .max_total_tasks = DEFAULT_MAX_TOTAL_TASKS,
+    .peer_timeout_ms = DEFAULT_PEER_TIMEOUT_MS,
+    .peer_retry_ms = DEFAULT_PEER_RETRY_MS,
+    .max_worker_credit = DEFAULT_WORKER_CREDIT,
+    .lease_horizon_ms = DEFAULT_LEASE_HORIZON_MS,
+    .ewma_weight = DEFAULT_EWMA_WEIGHT,
+};
+
+// Opis ustawień serwera. Ustawienia live są stosowane przy kolejnym użyciu po przeładowaniu (SIGHUP).
+// Minimalny buffer_size mieści linię TASK z najdłuższym opisem zadania.
+static ConfigOption server_options[] = {
+    { "host", CFG_STRING, server_config.host, sizeof(server_config.host), 0, 0, 0, "adres węzła w klastrze", 0 },
+    { "listen_address", CFG_STRING, server_config.listen_address, sizeof(server_config.listen_address), 0, 0, 0, "adres nasłuchu TCP", 0 },
+    { "port", CFG_INT, &server_config.port, 0, 1, 65535, 0, "port TCP", 0 },
+    { "unix_socket", CFG_STRING, server_config.unix_socket, sizeof(server_config.unix_socket), 0, 0, 0, "ścieżka gniazda AF_UNIX (puste - wg portu)", 0 },
+    { "listen_backlog", CFG_INT, &server_config.listen_backlog, 0, 1, 65535, 0, "kolejka oczekujących połączeń", 0 },
+    { "peers", CFG_STRING, server_config.peers, sizeof(server_config.peers), 0, 0, 0, "peery klastra rozdzielone przecinkami", 0 },
+    { "buffer_size", CFG_INT, &server_config.buffer_size, 0, 512, 65536, 0, "rozmiar bufora linii protokołu", 0 },
+    { "initial_capacity", CFG_INT, &server_config.initial_capacity, 0, 2, 1000000, 0, "początkowa pojemność tablic połączeń", 0 },
+    { "realloc_increment", CFG_INT, &server_config.realloc_increment, 0, 1, 1000000, 1, "krok zmiany pojemności tablic połączeń", 0 },
+    { "max_total_tasks", CFG_INT, &server_config.max_total_tasks, 0, 1, 10000000, 0, "pojemność puli zadań", 0 },
+    { "peer_timeout_ms", CFG_INT, &server_config.peer_timeout_ms, 0, 1, 60000, 1, "limit czasu żądania do peera", 0 },
+    { "peer_retry_ms", CFG_INT, &server_config.peer_retry_ms, 0, 0, 3600000, 1, "czas pomijania niedostępnego peera", 0 },
+    { "max_worker_credit", CFG_INT, &server_config.max_worker_credit, 0, 1, MAX_WORKER_CREDIT, 1, "maksymalne okno kredytowe workera", 0 },
+    { "lease_horizon_ms", CFG_INT, &server_config.lease_horizon_ms, 0, 0, 3600000, 1, "horyzont dzierżawy zadań", 0 },
+    { "ewma_weight", CFG_DOUBLE, &server_config.ewma_weight, 0, 0.01, 1, 1, "waga nowej próbki w średnich kroczących", 0 },
+};
+#define NUM_SERVER_OPTIONS ((int)(sizeof(server_options) / sizeof(server_options[0])))
+
+// Ustawiana przez SIGHUP; konfiguracja jest przeładowywana w pętli głównej (poza obsługą sygnału).
+static volatile sig_atomic_t reload_requested = 0;
+
+static void handle_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Użycie: %s [--config plik] [--peer host:port]... [--<ustawienie> wartość]...\n", program);
+    fprintf(stderr, "Ustawienia (także w pliku jako 'klucz = wartość' i w zmiennych %s<KLUCZ>):\n", ENV_PREFIX);
+    CFG_print_usage(server_options, NUM_SERVER_OPTIONS);
+}
+
+// Przeładowuje plik konfiguracyjny po SIGHUP.
+static void reload_config(const char *config_path) {
+    int old_peer_timeout_ms = server_config.peer_timeout_ms;
+    if (config_path[0] == '\0') {
+        printf("[MAIN] SIGHUP: brak pliku konfiguracyjnego (--config), nic do przeładowania.\n");
+        return;
+    }
+    printf("[MAIN] SIGHUP: przeładowanie konfiguracji z '%s'.\n", config_path);
+    int changed = CFG_reload_file(server_options, NUM_SERVER_OPTIONS, config_path);
+    if (changed < 0) {
+        printf("[MAIN] Przeładowanie nieudane - konfiguracja bez zmian.\n");
+        return;
+    }
+    if (server_config.peer_timeout_ms != old_peer_timeout_ms) {
+        // Bez zamykania połączeń - właściciele wiążą z nimi zadania przejęte przez ten węzeł
+        CM_update_timeouts();
+    }
+    printf("[MAIN] Zmieniono ustawień: %d.\n", changed);
+}
 
 // Główna funkcja serwera.
-int main() {
+// Użycie: ./server_app [--config plik] [--peer host:port]... [--<ustawienie> wartość]...
+// Kolejność źródeł ustawień: wiersz poleceń > zmienne WM_SERVER_* > plik konfiguracyjny > wartości domyślne.
+// Przykład klastra na jednym hoście:
+//   ./server_app --port 8080 --peer 8081 --peer 8082
+//   ./server_app --port 8081 --peer 8080 --peer 8082
+//   ./server_app --port 8082 --peer 8080 --peer 8081
+int main(int argc, char *argv[]) {
     int server_fd;
+    char config_path[512] = "";
+    char *peers[CLUSTER_MAX_NODES];
+    int num_peers = 0;
     
     struct pollfd *client_fds = NULL; 
     WorkerInfo *worker_infos = NULL;
     int num_used_fds = 0;
     int current_capacity = 0;
 
+    // Plik konfiguracyjny: --config lub WM_SERVER_CONFIG (wczytywany przed pozostałymi źródłami)
+    if (getenv(ENV_PREFIX "CONFIG") != NULL) {
+        snprintf(config_path, sizeof(config_path), "%s", getenv(ENV_PREFIX "CONFIG"));
+    }
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0) {
+            snprintf(config_path, sizeof(config_path), "%s", argv[i + 1]);
+        }
+    }
+    if ((config_path[0] != '\0' && CFG_load_file(server_options, NUM_SERVER_OPTIONS, config_path) < 0) ||
+        CFG_load_env(server_options, NUM_SERVER_OPTIONS, ENV_PREFIX) < 0) {
+        fprintf(stderr, "[MAIN] Błąd konfiguracji. Zamykanie.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Parsowanie argumentów wiersza poleceń (--peer można podać wielokrotnie)
+    char cli_peers[sizeof(server_config.peers)] = "";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            i++;
+        } else if (strcmp(argv[i], "--peer") == 0 && i + 1 < argc) {
+            size_t len = strlen(cli_peers);
+            snprintf(cli_peers + len, sizeof(cli_peers) - len, "%s%s", len > 0 ? "," : "", argv[++i]);
+        } else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc &&
+                   CFG_set(server_options, NUM_SERVER_OPTIONS, argv[i] + 2, argv[i + 1], CFG_SOURCE_CLI) == 0) {
+            i++;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (cli_peers[0] != '\0' && CFG_set(server_options, NUM_SERVER_OPTIONS, "peers", cli_peers, CFG_SOURCE_CLI) < 0) {
+        return EXIT_FAILURE;
+    }
+    CFG_dump(server_options, NUM_SERVER_OPTIONS, "[MAIN]");
+
+    // Podział listy peerów (w miejscu - server_config.peers nie jest przeładowywane)
+    char peers_copy[sizeof(server_config.peers)];
+    snprintf(peers_copy, sizeof(peers_copy), "%s", server_config.peers);
+    for (char *save = NULL, *spec = strtok_r(peers_copy, ", ", &save); spec != NULL; spec = strtok_r(NULL, ", ", &save)) {
+        if (num_peers == CLUSTER_MAX_NODES) {
+            fprintf(stderr, "[MAIN] Zbyt wielu peerów (maksymalnie %d).\n", CLUSTER_MAX_NODES - 1);
+            return EXIT_FAILURE;
+        }
+        peers[num_peers++] = spec;
+    }
+
+    // Zapis do zamkniętego gniazda (worker lub peer) nie może zakończyć procesu
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGHUP jest zablokowany poza oczekiwaniem w ppoll(), które atomowo przywraca pierwotną maskę -
+    // sygnał nadesłany po sprawdzeniu reload_requested przerwie najbliższe oczekiwanie i nie zostanie zgubiony
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sighup;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+    sigset_t hup_mask, wait_mask;
+    sigemptyset(&hup_mask);
+    sigaddset(&hup_mask, SIGHUP);
+    sigprocmask(SIG_BLOCK, &hup_mask, &wait_mask);
+
+    // Inicjalizacja klastra (przed zadaniami - podział przestrzeni ID)
+    if (CM_init(server_config.host, server_config.port, peers, num_peers) == -1) {
+        fprintf(stderr, "[MAIN] Błąd konfiguracji klastra. Zamykanie.\n");
+        return EXIT_FAILURE;
+    }
+
     // Inicjalizacja menedżera workerów
-    server_fd = WM_init_manager(&client_fds, &worker_infos);
+    server_fd = WM_init_manager(server_config.port, &client_fds, &worker_infos);
     if (server_fd == -1) {
         fprintf(stderr, "[MAIN] Błąd inicjalizacji menedżera workerów. Zamykanie.\n");
         return EXIT_FAILURE;
@@ -28,7 +187,12 @@ int main() {
     num_used_fds = WM_get_num_used_fds();
     current_capacity = WM_get_current_capacity();
 
-    TM_init_tasks(); // Inicjalizacja zadań
+    if (TM_init_tasks() == -1) { // Inicjalizacja zadań
+        fprintf(stderr, "[MAIN] Błąd inicjalizacji puli zadań. Zamykanie.\n");
+        WM_cleanup_manager(server_fd, client_fds, worker_infos);
+        CM_cleanup();
+        return EXIT_FAILURE;
+    }
     printf("[MAIN] System gotowy. Oczekiwanie na workerów...\n");
 
     // --- Główna pętla serwera ---
@@ -37,11 +201,16 @@ int main() {
         // są modyfikowane bezpośrednio przez funkcje WM_handle_* dzięki przekazaniu ich adresów.
         // Nie ma potrzeby pobierania ich ponownie w każdej iteracji pętli.
 
-        int poll_count = poll(client_fds, num_used_fds, -1); // Oczekiwanie na zdarzenia
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_config(config_path);
+        }
+
+        int poll_count = ppoll(client_fds, num_used_fds, NULL, &wait_mask); // Oczekiwanie na zdarzenia lub SIGHUP
 
         if (poll_count < 0) {
-            if (errno == EINTR) { // Przerwanie przez sygnał
-                continue; // Ponowienie poll()
+            if (errno == EINTR) { // Przerwanie przez sygnał (np. SIGHUP)
+                continue; // Ponowienie ppoll() po przeładowaniu konfiguracji
             }
             perror("[MAIN] poll error");
             break; // Inny błąd poll, zakończenie pętli
@@ -55,8 +224,8 @@ int main() {
                 continue;
             }
 
-            if (client_fds[i].fd == server_fd) { // Zdarzenie na gnieździe nasłuchującym - nowe połączenie
-                int res = WM_handle_new_connection(server_fd, &client_fds, &worker_infos, &num_used_fds, &current_capacity);
+            if (WM_is_listening_fd(client_fds[i].fd)) { // Zdarzenie na gnieździe nasłuchującym (TCP lub AF_UNIX) - nowe połączenie
+                int res = WM_handle_new_connection(client_fds[i].fd, &client_fds, &worker_infos, &num_used_fds, &current_capacity);
                 if (res == -1) {
                     fprintf(stderr, "[MAIN] Błąd obsługi nowego połączenia.\n");
                 }
@@ -74,7 +243,8 @@ int main() {
     // --- Zwolnienie zasobów ---
     printf("[MAIN] Zamykanie serwera...\n");
     WM_cleanup_manager(server_fd, client_fds, worker_infos);
-    // TM_cleanup_tasks(); // Jeśli task_manager alokowałby dynamicznie pamięć
+    CM_cleanup();
+    TM_cleanup_tasks();
 
     return 0;
 }
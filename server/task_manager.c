@@ -1,17 +1,76 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "task_manager.h"
+#include "cluster_manager.h"
 #include "common_defs.h"
 
-// Tablica zadań.
-static Task all_tasks[MAX_TOTAL_TASKS];
+// Klucz wyznaczający węzeł klastra, który dodaje zadania testowe.
+#define DEMO_TASKS_KEY "demo-tasks"
+
+// Tablica zadań (pojemność: server_config.max_total_tasks).
+static Task *all_tasks = NULL;
 // Licznik ID zadań.
 static int next_task_id = 1;
 // Liczba zadań w systemie.
 static int total_tasks_count = 0;
 
-// Inicjalizacja puli zadań (dodanie zadań testowych).
-void TM_init_tasks() {
+// Wpis zbioru kluczy idempotencji (adresowanie otwarte, próbkowanie liniowe).
+// Skrót przyspiesza porównania, ale o zgodności decyduje pełny klucz - różne klucze
+// z tym samym skrótem to różne zgłoszenia.
+typedef struct {
+    uint64_t key_hash;              // Skrót klucza (0 - wolny wpis)
+    char key[MAX_IDEMPOTENCY_KEY];  // Pełny klucz
+    int task_id;                    // Zadanie utworzone dla klucza
+} IdempotencyEntry;
+
+static IdempotencyEntry *idempotency_keys = NULL;
+// Maska indeksu tablicy kluczy (rozmiar tablicy - 1, rozmiar jest potęgą 2).
+static unsigned int idempotency_mask = 0;
+
+// Funkcja skrótu FNV-1a (64 bity). Nigdy nie zwraca 0 (znacznik wolnego wpisu).
+static uint64_t key_hash(const char *key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
+
+// Zwraca wpis dla klucza: zajęty (klucz znany) lub wolny (miejsce na wstawienie).
+// Tablica nie zapełnia się: ma co najmniej dwa razy więcej wpisów niż pula zadań.
+static IdempotencyEntry *find_idempotency_entry(const char *key, uint64_t hash) {
+    unsigned int slot = (unsigned int)hash & idempotency_mask;
+    while (idempotency_keys[slot].key_hash != 0 &&
+           (idempotency_keys[slot].key_hash != hash || strcmp(idempotency_keys[slot].key, key) != 0)) {
+        slot = (slot + 1) & idempotency_mask;
+    }
+    return &idempotency_keys[slot];
+}
+
+// Inicjalizacja puli zadań (alokacja tablic i dodanie zadań testowych).
+int TM_init_tasks() {
+    unsigned int table_size = 1;
+    while (table_size < 2u * (unsigned int)server_config.max_total_tasks) {
+        table_size <<= 1;
+    }
+    all_tasks = (Task *)calloc(server_config.max_total_tasks, sizeof(Task));
+    idempotency_keys = (IdempotencyEntry *)calloc(table_size, sizeof(IdempotencyEntry));
+    if (all_tasks == NULL || idempotency_keys == NULL) {
+        perror("[TASK_MANAGER] calloc failed");
+        TM_cleanup_tasks();
+        return -1;
+    }
+    idempotency_mask = table_size - 1;
+
+    // W klastrze zadania testowe dodaje tylko jeden węzeł (właściciel stałego klucza),
+    // aby nie powstało N kopii każdego z nich
+    if (!CM_owns_key(DEMO_TASKS_KEY)) {
+        printf("[TASK_MANAGER] Zadania początkowe dodaje inny węzeł klastra.\n");
+        return 0;
+    }
     printf("[TASK_MANAGER] Dodawanie początkowych zadań...\n");
     TM_add_task_to_queue("REVERSE 'hello world'");
     TM_add_task_to_queue("ADD 10 20");
@@ -21,20 +80,68 @@ void TM_init_tasks() {
     TM_add_task_to_queue("REVERSE 'distributed systems are cool'");
     TM_add_task_to_queue("ADD 123 456");
     printf("[TASK_MANAGER] Początkowe zadania dodane.\n");
+    return 0;
+}
+
+// Zwolnienie pamięci puli zadań.
+void TM_cleanup_tasks() {
+    free(all_tasks);
+    free(idempotency_keys);
+    all_tasks = NULL;
+    idempotency_keys = NULL;
+    total_tasks_count = 0;
 }
 
 // Dodanie nowego zadania do puli (status PENDING).
-void TM_add_task_to_queue(const char *description) {
-    if (total_tasks_count < MAX_TOTAL_TASKS) {
+int TM_add_task_to_queue(const char *description) {
+    if (total_tasks_count < server_config.max_total_tasks) {
+        // Pominięcie ID należących do innych węzłów klastra
+        while (!CM_owns_task_id(next_task_id)) {
+            next_task_id++;
+        }
         all_tasks[total_tasks_count].id = next_task_id++;
         strncpy(all_tasks[total_tasks_count].description, description, sizeof(all_tasks[total_tasks_count].description) - 1);
         all_tasks[total_tasks_count].description[sizeof(all_tasks[total_tasks_count].description) - 1] = '\0'; // Zapewnienie null-terminacji
         all_tasks[total_tasks_count].status = TASK_STATUS_PENDING;
+        all_tasks[total_tasks_count].lease_epoch = 0;
+        all_tasks[total_tasks_count].peer_fd = -1;
         printf("[TASK_MANAGER] Dodano zadanie %d: '%s' (status: PENDING)\n", all_tasks[total_tasks_count].id, all_tasks[total_tasks_count].description);
-        total_tasks_count++;
+        return all_tasks[total_tasks_count++].id;
     } else {
-        printf("[TASK_MANAGER] Osiągnięto maksymalną liczbę zadań (%d). Nie można dodać: '%s'\n", MAX_TOTAL_TASKS, description);
+        printf("[TASK_MANAGER] Osiągnięto maksymalną liczbę zadań (%d). Nie można dodać: '%s'\n", server_config.max_total_tasks, description);
+        return -1;
+    }
+}
+
+// Liczba wolnych miejsc w puli zadań.
+int TM_free_task_slots() {
+    return server_config.max_total_tasks - total_tasks_count;
+}
+
+// Dodanie zadania z kluczem idempotencji.
+int TM_submit_task(const char *idempotency_key, const char *description, int *is_duplicate) {
+    *is_duplicate = 0;
+    if (idempotency_key == NULL) {
+        return TM_add_task_to_queue(description);
+    }
+
+    if (strlen(idempotency_key) >= MAX_IDEMPOTENCY_KEY) {
+        return -1;
+    }
+    uint64_t hash = key_hash(idempotency_key);
+    IdempotencyEntry *entry = find_idempotency_entry(idempotency_key, hash);
+    if (entry->key_hash != 0) {
+        *is_duplicate = 1;
+        printf("[TASK_MANAGER] Ponowne zgłoszenie z kluczem '%s' - zadanie %d już istnieje.\n", idempotency_key, entry->task_id);
+        return entry->task_id;
+    }
+    int task_id = TM_add_task_to_queue(description);
+    if (task_id != -1) {
+        entry->key_hash = hash;
+        strcpy(entry->key, idempotency_key);
+        entry->task_id = task_id;
     }
+    return task_id;
 }
 
 // Pobranie następnego zadania (status PENDING) i zmiana statusu na IN_PROGRESS.
@@ -42,7 +149,9 @@ Task *TM_get_next_task() {
     for (int i = 0; i < total_tasks_count; i++) {
         if (all_tasks[i].status == TASK_STATUS_PENDING) {
             all_tasks[i].status = TASK_STATUS_IN_PROGRESS;
-            printf("[TASK_MANAGER] Przydzielono zadanie %d: '%s' (status: IN_PROGRESS)\n", all_tasks[i].id, all_tasks[i].description);
+            all_tasks[i].lease_epoch++;
+            all_tasks[i].peer_fd = -1;
+            printf("[TASK_MANAGER] Przydzielono zadanie %d: '%s' (status: IN_PROGRESS, dzierżawa %u)\n", all_tasks[i].id, all_tasks[i].description, all_tasks[i].lease_epoch);
             return &all_tasks[i];
         }
     }
@@ -59,11 +168,36 @@ Task *TM_find_task_by_id(int id) {
     return NULL; // Nie znaleziono zadania
 }
 
+// Rejestracja wyniku dzierżawy zadania (dokładnie jedno zakończenie na zadanie).
+int TM_complete_task(int task_id, unsigned int epoch) {
+    Task *task = TM_find_task_by_id(task_id);
+    if (task == NULL || epoch == 0 || epoch > task->lease_epoch) {
+        return TM_RESULT_STALE;
+    }
+    if (task->status == TASK_STATUS_COMPLETED) {
+        printf("[TASK_MANAGER] Zadanie %d już zakończone - odrzucono duplikat wyniku (dzierżawa %u).\n", task_id, epoch);
+        return TM_RESULT_DUPLICATE;
+    }
+    if (task->status == TASK_STATUS_CANCELLED) {
+        printf("[TASK_MANAGER] Zadanie %d anulowane - odrzucono wynik (dzierżawa %u).\n", task_id, epoch);
+        return TM_RESULT_CANCELLED;
+    }
+    // Wynik wcześniejszej dzierżawy jest przyjmowany także po re-kolejkowaniu lub ponownym
+    // przydziale - bieżący dzierżawca dostanie przy swoim wyniku odpowiedź o duplikacie.
+    task->status = TASK_STATUS_COMPLETED;
+    task->peer_fd = -1;
+    printf("[TASK_MANAGER] Zadanie %d ('%s') status: COMPLETED (dzierżawa %u).\n", task->id, task->description, epoch);
+    return TM_RESULT_ACCEPTED;
+}
+
 // Zmiana statusu zadania z IN_PROGRESS na PENDING.
-void TM_re_queue_task(int task_id) {
+void TM_re_queue_task(int task_id, unsigned int epoch) {
     Task *task = TM_find_task_by_id(task_id);
-    if (task != NULL && task->status == TASK_STATUS_IN_PROGRESS) {
+    if (task != NULL && task->status == TASK_STATUS_IN_PROGRESS && task->lease_epoch != epoch) {
+        printf("[TASK_MANAGER] Pominięto re-kolejkowanie zadania %d: dzierżawa %u nieaktualna (bieżąca %u).\n", task_id, epoch, task->lease_epoch);
+    } else if (task != NULL && task->status == TASK_STATUS_IN_PROGRESS) {
         task->status = TASK_STATUS_PENDING;
+        task->peer_fd = -1;
         printf("[TASK_MANAGER] Zadanie %d ('%s') ponownie w kolejce (status: PENDING).\n", task->id, task->description);
     } else if (task != NULL) {
         printf("[TASK_MANAGER] Ostrzeżenie: Próba re-kolejkowania zadania %d (status: %d), nie jest IN_PROGRESS.\n", task_id, task->status);
@@ -71,3 +205,25 @@ void TM_re_queue_task(int task_id) {
         printf("[TASK_MANAGER] Błąd: Nie znaleziono zadania ID %d do re-kolejkowania.\n", task_id);
     }
 }
+
+// Anulowanie zadania oczekującego lub w trakcie realizacji.
+int TM_cancel_task(int task_id) {
+    Task *task = TM_find_task_by_id(task_id);
+    if (task == NULL || (task->status != TASK_STATUS_PENDING && task->status != TASK_STATUS_IN_PROGRESS)) {
+        return -1;
+    }
+    task->status = TASK_STATUS_CANCELLED;
+    task->peer_fd = -1;
+    printf("[TASK_MANAGER] Zadanie %d ('%s') status: CANCELLED.\n", task->id, task->description);
+    return 0;
+}
+
+// Re-kolejkowanie zadań przejętych przez rozłączonego peera.
+void TM_re_queue_peer_tasks(int peer_fd) {
+    for (int i = 0; i < total_tasks_count; i++) {
+        if (all_tasks[i].status == TASK_STATUS_IN_PROGRESS && all_tasks[i].peer_fd == peer_fd) {
+            printf("[TASK_MANAGER] Peer (fd %d) rozłączył się w trakcie zadania %d.\n", peer_fd, all_tasks[i].id);
+            TM_re_queue_task(all_tasks[i].id, all_tasks[i].lease_epoch);
+        }
+    }
+}
@@ -3,15 +3,37 @@
 
 #include "common_defs.h" // Dla definicji Task
 
+// Wyniki TM_complete_task.
+#define TM_RESULT_ACCEPTED   0  // Zadanie zakończone tym wynikiem
+#define TM_RESULT_DUPLICATE  1  // Zadanie było już zakończone - wynik odrzucony
+#define TM_RESULT_CANCELLED  2  // Zadanie zostało anulowane - wynik odrzucony
+#define TM_RESULT_STALE     -1  // Nieznane zadanie lub niewydany numer dzierżawy
+
 // Interfejs modułu zarządzania pulą zadań.
 
-// Inicjuje pulę zadań.
-void TM_init_tasks();
+// Inicjuje pulę zadań o pojemności server_config.max_total_tasks.
+// Zwraca 0 (sukces) lub -1 (błąd alokacji pamięci).
+int TM_init_tasks();
+
+// Zwalnia pamięć puli zadań.
+void TM_cleanup_tasks();
 
 // Dodaje nowe zadanie do puli (status PENDING).
-void TM_add_task_to_queue(const char *description);
+// Nadaje wyłącznie ID, których właścicielem jest ten węzeł klastra.
+// Zwraca ID zadania lub -1, jeśli pula jest pełna.
+int TM_add_task_to_queue(const char *description);
+
+// Zwraca liczbę wolnych miejsc w puli (zadania nie są z niej usuwane - także zakończone).
+int TM_free_task_slots();
+
+// Dodaje zadanie z kluczem idempotencji podanym przez zgłaszającego (NULL - bez klucza).
+// Ponowne zgłoszenie z tym samym kluczem nie tworzy nowego zadania: zwraca ID
+// istniejącego i ustawia *is_duplicate na 1.
+// Zwraca ID zadania lub -1, jeśli pula jest pełna (lub klucz nie mieści się w MAX_IDEMPOTENCY_KEY).
+int TM_submit_task(const char *idempotency_key, const char *description, int *is_duplicate);
 
-// Pobiera następne zadanie (status PENDING), zmienia status na IN_PROGRESS.
+// Pobiera następne zadanie (status PENDING), zmienia status na IN_PROGRESS
+// i nadaje mu nowy numer dzierżawy (lease_epoch).
 // Zwraca wskaźnik do zadania lub NULL, jeśli brak zadań.
 Task *TM_get_next_task();
 
@@ -19,7 +41,20 @@ Task *TM_get_next_task();
 // Zwraca wskaźnik do zadania lub NULL, jeśli nie znaleziono.
 Task *TM_find_task_by_id(int id);
 
-// Zmienia status zadania z IN_PROGRESS na PENDING (re-kolejkowanie).
-void TM_re_queue_task(int task_id);
+// Rejestruje wynik dzierżawy epoch zadania. Pierwszy wynik dowolnej wydanej dzierżawy
+// kończy zadanie (praca workera, który się rozłączył, nie jest tracona); każdy kolejny
+// jest duplikatem. Zwraca TM_RESULT_ACCEPTED, TM_RESULT_DUPLICATE, TM_RESULT_CANCELLED lub TM_RESULT_STALE.
+int TM_complete_task(int task_id, unsigned int epoch);
+
+// Zmienia status zadania z IN_PROGRESS na PENDING (re-kolejkowanie),
+// o ile epoch jest bieżącą dzierżawą - nieaktualna dzierżawa nie cofa nowszego przydziału.
+void TM_re_queue_task(int task_id, unsigned int epoch);
+
+// Anuluje zadanie oczekujące (PENDING) lub w trakcie realizacji (IN_PROGRESS).
+// Zwraca 0 (sukces) lub -1 (brak zadania lub zadanie już zakończone/anulowane).
+int TM_cancel_task(int task_id);
+
+// Re-kolejkuje wszystkie zadania przejęte przez peera połączonego deskryptorem peer_fd.
+void TM_re_queue_peer_tasks(int peer_fd);
 
 #endif // TASK_MANAGER_H
@@ -2,13 +2,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <poll.h>
+#include <time.h>
 
 #include "worker_manager.h" // Nagłówek modułu
 #include "task_manager.h"   // Zarządzanie zadaniami
+#include "cluster_manager.h" // Klaster serwerów
 #include "common_defs.h"    // Definicje ogólne
 
 // --- Zmienne globalne modułu ---
@@ -19,11 +24,189 @@ static WorkerInfo *worker_infos = NULL;  // Tablica informacji o workerach
 static int current_capacity = 0;
 // Liczba faktycznie używanych deskryptorów/workerów.
 static int num_used_fds = 0;
+// Gniazdo nasłuchujące TCP.
+static int tcp_server_fd = -1;
+// Gniazdo nasłuchujące AF_UNIX dla workerów działających na tym samym hoście (-1 jeśli brak).
+static int unix_server_fd = -1;
+// Ścieżka gniazda AF_UNIX (zależna od portu, aby kilka węzłów mogło działać na jednym hoście).
+static char unix_socket_path[108] = "";
+// Stan pętli głównej na czas obsługi komendy (WM_handle_worker_data) - używany przez
+// wait_serving_peers do obsługi żądań PEER_* w trakcie oczekiwania na odpowiedź peera.
+static struct pollfd **active_fds_ptr = NULL;
+static WorkerInfo **active_info_ptr = NULL;
+static int *active_num_used_fds_ptr = NULL;
+static int *active_capacity_ptr = NULL;
+static int active_worker_idx = -1; // Połączenie, którego komenda jest właśnie obsługiwana
+static int serving_peers = 0;      // 1 - trwa zagnieżdżona obsługa żądania peera
+
+static int wait_serving_peers(int fd, short events, int timeout_ms);
+
+// --- Funkcje pomocnicze ---
+
+// Tworzy gniazdo nasłuchujące AF_UNIX pod ścieżką unix_socket_path.
+// Zwraca deskryptor gniazda lub -1 w przypadku błędu.
+static int create_unix_listener() {
+    struct sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[WM] unix socket failed");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, unix_socket_path, sizeof(address.sun_path) - 1);
+    unlink(unix_socket_path); // Usunięcie pozostałości po poprzednim uruchomieniu
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("[WM] unix bind failed");
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, server_config.listen_backlog) < 0) {
+        perror("[WM] unix listen");
+        close(fd);
+        unlink(unix_socket_path);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK); // Jak gniazdo TCP - patrz WM_init_manager
+    return fd;
+}
+
+// Zwraca bieżący czas monotoniczny w milisekundach (z częścią ułamkową - zadania bywają krótsze niż 1 ms).
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Oblicza okno kredytowe workera: maksymalną liczbę jednocześnie dzierżawionych zadań.
+// Worker może trzymać około lease_horizon_ms pracy ponad bieżące zadanie - szybkie zadania
+// dostają szersze okno (worker nie czeka na sieć), wolne najwyżej jedno (nie blokują zadań
+// bezczynnym workerom). Przed pierwszym pomiarem okno wynosi 1.
+static int worker_credit(const WorkerInfo *worker) {
+    if (!worker->has_service_sample) {
+        return 1;
+    }
+    // Ograniczenie przed konwersją na int - bardzo krótkie zadania (średnia bliska 0) przepełniłyby int
+    double credit = 1 + server_config.lease_horizon_ms / worker->avg_service_ms;
+    return credit > server_config.max_worker_credit ? server_config.max_worker_credit : (int)credit;
+}
+
+// Przydziela workerowi następne zadanie (z lokalnej puli lub przejęte od peera) i zapisuje dzierżawę.
+// Zwraca ID zadania (oraz numer dzierżawy w *epoch) lub -1, jeśli brak zadań.
+static int lease_next_task(WorkerInfo *worker, unsigned int *epoch, char *description, int description_size) {
+    int task_id = -1;
+    Task *task = TM_get_next_task(); // Pobranie zadania z lokalnej puli
+    if (task != NULL) {
+        task_id = task->id;
+        *epoch = task->lease_epoch;
+        snprintf(description, description_size, "%s", task->description);
+    } else if (CM_is_enabled()) { // Brak lokalnych zadań - próba przejęcia zadania od peera
+        CM_steal_task(&task_id, epoch, description, description_size);
+    }
+    if (task_id != -1) {
+        if (worker->num_leases == 0) {
+            worker->last_event_ms = now_ms(); // Początek pomiaru czasu obsługi
+        }
+        worker->leased_epochs[worker->num_leases] = *epoch;
+        worker->leased_task_ids[worker->num_leases++] = task_id;
+        worker->status = WORKER_STATUS_BUSY;
+    }
+    return task_id;
+}
+
+// Sprawdza, czy worker nadal dzierżawi zadanie z danym numerem dzierżawy.
+static int holds_lease(const WorkerInfo *worker, int task_id, unsigned int epoch) {
+    for (int i = 0; i < worker->num_leases; i++) {
+        if (worker->leased_task_ids[i] == task_id && worker->leased_epochs[i] == epoch) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Usuwa dzierżawę zadania z okna workera.
+// Zwraca 0 (sukces) lub -1, jeśli worker nie dzierżawi zadania.
+static int remove_lease(WorkerInfo *worker, int task_id) {
+    for (int i = 0; i < worker->num_leases; i++) {
+        if (worker->leased_task_ids[i] == task_id) {
+            worker->num_leases--;
+            worker->leased_task_ids[i] = worker->leased_task_ids[worker->num_leases];
+            worker->leased_epochs[i] = worker->leased_epochs[worker->num_leases];
+            if (worker->num_leases == 0) {
+                worker->status = WORKER_STATUS_IDLE;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Usuwa dzierżawę zakończonego zadania i aktualizuje średnią kroczącą czasu obsługi workera.
+// Zwraca 0 (sukces) lub -1, jeśli worker nie dzierżawi zadania.
+static int release_lease(WorkerInfo *worker, int task_id) {
+    if (remove_lease(worker, task_id) < 0) {
+        return -1;
+    }
+    // Czas od poprzedniego wyniku (lub przydziału do pustego okna) - przy pełnym
+    // oknie odpowiada czasowi wykonania jednego zadania przez workera
+    double now = now_ms();
+    double sample = now - worker->last_event_ms;
+    worker->avg_service_ms = !worker->has_service_sample ? sample
+        : server_config.ewma_weight * sample + (1 - server_config.ewma_weight) * worker->avg_service_ms;
+    worker->has_service_sample = 1;
+    worker->last_event_ms = now;
+    return 0;
+}
+
+// Odwołuje dzierżawy zadania u workerów tego węzła: od razu zwalnia miejsce w oknie
+// i wysyła workerowi niezamówiony komunikat "CANCEL <ID>", który przerywa wykonywanie.
+static void cancel_local_leases(int task_id, struct pollfd *fds, WorkerInfo *infos, int num_fds) {
+    for (int i = 0; i < num_fds; i++) {
+        if (infos[i].fd != -1 && remove_lease(&infos[i], task_id) == 0) {
+            if (infos[i].num_leases > 0) {
+                // Czas anulowanego zadania nie może trafić do próbki następnego wyniku (zawyżona średnia)
+                infos[i].last_event_ms = now_ms();
+            }
+            char message[64];
+            snprintf(message, sizeof(message), "CANCEL %d\n", task_id);
+            send(fds[i].fd, message, strlen(message), 0);
+            printf("[WM] Wysłano CANCEL zadania %d do workera (fd %d).\n", task_id, fds[i].fd);
+        }
+    }
+}
+
+// Sprawdza, czy przyjęty wynik pochodzi z wcześniejszej dzierżawy niż bieżąca - wtedy
+// bieżący dzierżawca wykonuje już zakończone zadanie.
+static int is_superseded(int task_id, unsigned int epoch) {
+    Task *task = TM_find_task_by_id(task_id);
+    return task != NULL && task->lease_epoch != epoch;
+}
+
+// Odwołuje dzierżawy zadania zakończonego wynikiem wcześniejszej dzierżawy - u workerów
+// tego węzła i, w klastrze, u peerów (PEER_CANCEL; zakończonego zadania właściciel nie anuluje).
+static void release_superseded_leases(int task_id, struct pollfd *fds, WorkerInfo *infos, int num_fds) {
+    printf("[WM] Zadanie %d zakończone wynikiem wcześniejszej dzierżawy - odwołanie bieżących dzierżaw.\n", task_id);
+    cancel_local_leases(task_id, fds, infos, num_fds);
+    if (CM_is_enabled()) {
+        char owner_reply[server_config.buffer_size];
+        CM_broadcast_cancel(task_id, owner_reply, sizeof(owner_reply));
+    }
+}
+
+// Zwraca odpowiedź protokołu dla wyniku TM_complete_task.
+static const char *result_response(int outcome) {
+    switch (outcome) {
+        case TM_RESULT_ACCEPTED:  return "OK RESULT_RECEIVED\n";
+        case TM_RESULT_DUPLICATE: return "OK DUPLICATE_RESULT\n";
+        case TM_RESULT_CANCELLED: return "OK TASK_CANCELLED\n";
+        default:                  return "ERROR STALE_LEASE\n";
+    }
+}
 
 // --- Implementacja funkcji menedżera workerów ---
 
 // Inicjuje menedżer workerów, tworzy gniazdo nasłuchujące i alokuje początkowe tablice dla połączeń.
-int WM_init_manager(struct pollfd **fds_ptr, WorkerInfo **info_ptr) {
+int WM_init_manager(int port, struct pollfd **fds_ptr, WorkerInfo **info_ptr) {
     int server_fd;
     struct sockaddr_in address;
     int opt = 1;
@@ -38,28 +221,55 @@ int WM_init_manager(struct pollfd **fds_ptr, WorkerInfo **info_ptr) {
         close(server_fd);
         return -1;
     }
+    memset(&address, 0, sizeof(address));
     address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_config.listen_address, &address.sin_addr) <= 0) {
+        fprintf(stderr, "[WM] Niepoprawny adres nasłuchu: '%s'\n", server_config.listen_address);
+        close(server_fd);
+        return -1;
+    }
     if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
         perror("[WM] bind failed");
         close(server_fd);
         return -1;
     }
-    if (listen(server_fd, 10) < 0) {
+    if (listen(server_fd, server_config.listen_backlog) < 0) {
         perror("[WM] listen");
         close(server_fd);
         return -1;
     }
-    printf("[WM] Serwer nasłuchuje na porcie %d\n", PORT);
+    printf("[WM] Serwer nasłuchuje na %s:%d\n", server_config.listen_address, port);
+    // Gniazda nasłuchujące są nieblokujące: połączenie zgłoszone przez poll() mogło zostać
+    // przyjęte już w wait_serving_peers, a accept() nie może wtedy zatrzymać pętli głównej
+    fcntl(server_fd, F_SETFL, O_NONBLOCK);
+    tcp_server_fd = server_fd;
+
+    // Gniazdo AF_UNIX jest opcjonalne - błąd nie blokuje pracy serwera przez TCP
+    if (server_config.unix_socket[0] != '\0') {
+        snprintf(unix_socket_path, sizeof(unix_socket_path), "%s", server_config.unix_socket);
+    } else {
+        snprintf(unix_socket_path, sizeof(unix_socket_path), UNIX_SOCKET_PATH_FMT, port);
+    }
+    unix_server_fd = create_unix_listener();
+    if (unix_server_fd != -1) {
+        printf("[WM] Serwer nasłuchuje na gnieździe AF_UNIX %s\n", unix_socket_path);
+    } else {
+        printf("[WM] Ostrzeżenie: Gniazdo AF_UNIX niedostępne, tylko TCP.\n");
+    }
 
     // Alokacja pamięci dla tablic połączeń i informacji o workerach
-    current_capacity = INITIAL_CAPACITY;
+    current_capacity = server_config.initial_capacity;
     client_fds = (struct pollfd *)malloc(current_capacity * sizeof(struct pollfd));
     worker_infos = (WorkerInfo *)malloc(current_capacity * sizeof(WorkerInfo));
     if (client_fds == NULL || worker_infos == NULL) {
         perror("[WM] Initial malloc for client_fds or worker_infos failed");
         close(server_fd);
+        if (unix_server_fd != -1) {
+            close(unix_server_fd);
+            unlink(unix_socket_path);
+            unix_server_fd = -1;
+        }
         if (client_fds) free(client_fds); // Zwolnienie w przypadku częściowego błędu
         if (worker_infos) free(worker_infos);
         return -1;
@@ -71,15 +281,21 @@ int WM_init_manager(struct pollfd **fds_ptr, WorkerInfo **info_ptr) {
         worker_infos[i].fd = -1;
     }
 
-    // Dodanie gniazda nasłuchującego do monitorowania przez poll()
+    // Dodanie gniazd nasłuchujących do monitorowania przez poll()
     client_fds[0].fd = server_fd;
     client_fds[0].events = POLLIN;
     num_used_fds = 1;
+    if (unix_server_fd != -1) {
+        client_fds[1].fd = unix_server_fd;
+        client_fds[1].events = POLLIN;
+        num_used_fds = 2;
+    }
 
     // Przekazanie wskaźników do zaalokowanej pamięci
     *fds_ptr = client_fds;
     *info_ptr = worker_infos;
 
+    CM_set_wait_function(wait_serving_peers);
     return server_fd;
 }
 
@@ -87,10 +303,13 @@ int WM_init_manager(struct pollfd **fds_ptr, WorkerInfo **info_ptr) {
 void WM_cleanup_manager(int server_fd, struct pollfd *fds, WorkerInfo *info) {
     printf("[WM] Zamykanie menedżera workerów...\n");
     if (fds != NULL) {
-        // Zamknięcie gniazd klientów
+        // Zamknięcie gniazd klientów i zwolnienie ich buforów wejściowych
         for (int i = 0; i < num_used_fds; i++) {
-            if (fds[i].fd != -1 && fds[i].fd != server_fd) {
+            if (fds[i].fd != -1 && fds[i].fd != server_fd && fds[i].fd != unix_server_fd) {
                 close(fds[i].fd);
+                if (info != NULL) {
+                    free(info[i].inbuf);
+                }
             }
         }
         free(fds);
@@ -101,34 +320,55 @@ void WM_cleanup_manager(int server_fd, struct pollfd *fds, WorkerInfo *info) {
         worker_infos = NULL;
     }
     close(server_fd); // Zamknięcie gniazda nasłuchującego
+    if (unix_server_fd != -1) {
+        close(unix_server_fd);
+        unlink(unix_socket_path);
+        unix_server_fd = -1;
+    }
     printf("[WM] Menedżer workerów zamknięty.\n");
 }
 
+// Sprawdzenie, czy deskryptor jest gniazdem nasłuchującym.
+int WM_is_listening_fd(int fd) {
+    return fd != -1 && (fd == tcp_server_fd || fd == unix_server_fd);
+}
+
 // Obsługa nowego połączenia.
-int WM_handle_new_connection(int server_fd, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int *num_used_fds_ptr, int *current_capacity_ptr) {
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
+int WM_handle_new_connection(int listen_fd, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int *num_used_fds_ptr, int *current_capacity_ptr) {
+    struct sockaddr_storage address; // Pomieści zarówno sockaddr_in, jak i sockaddr_un
+    socklen_t addrlen = sizeof(address);
     // Akceptacja nowego połączenia
-    int new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen);
+    int new_socket = accept(listen_fd, (struct sockaddr *)&address, &addrlen);
     if (new_socket < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0; // Połączenie przyjęte już w wait_serving_peers
+        }
         perror("[WM] accept error");
         return -1;
     }
 
-    printf("[WM] Nowy worker połączył się: deskryptor %d\n", new_socket);
+    printf("[WM] Nowy worker połączył się (%s): deskryptor %d\n", listen_fd == unix_server_fd ? "AF_UNIX" : "TCP", new_socket);
+
+    char *inbuf = (char *)malloc(server_config.buffer_size);
+    if (inbuf == NULL) {
+        perror("[WM] malloc inbuf failed, cannot add new client");
+        close(new_socket);
+        return -1;
+    }
 
     // Sprawdzenie pojemności tablic i ewentualna realokacja
     if (*num_used_fds_ptr == *current_capacity_ptr) {
         printf("[WM] Tablica klientów pełna (%d/%d). Reallocating...\n", *num_used_fds_ptr, *current_capacity_ptr);
         
         int old_capacity = *current_capacity_ptr;
-        *current_capacity_ptr += REALLOC_INCREMENT; // Zwiększenie pojemności
+        *current_capacity_ptr += server_config.realloc_increment; // Zwiększenie pojemności
 
         // Realokacja tablicy pollfd
         struct pollfd *temp_fds = (struct pollfd *)realloc(*fds_ptr, *current_capacity_ptr * sizeof(struct pollfd));
         if (temp_fds == NULL) {
             perror("[WM] realloc client_fds failed, cannot add new client");
             close(new_socket);
+            free(inbuf);
             *current_capacity_ptr = old_capacity; // Przywrócenie starej pojemności
             return -1;
         }
@@ -139,6 +379,7 @@ int WM_handle_new_connection(int server_fd, struct pollfd **fds_ptr, WorkerInfo
         if (temp_worker_infos == NULL) {
             perror("[WM] realloc worker_infos failed, cannot add new client");
             close(new_socket);
+            free(inbuf);
             *current_capacity_ptr = old_capacity; // Przywrócenie starej pojemności
             return -1;
         }
@@ -158,18 +399,398 @@ int WM_handle_new_connection(int server_fd, struct pollfd **fds_ptr, WorkerInfo
     // Inicjalizacja informacji o nowym workerze
     (*info_ptr)[*num_used_fds_ptr].fd = new_socket;
     (*info_ptr)[*num_used_fds_ptr].status = WORKER_STATUS_IDLE;
-    (*info_ptr)[*num_used_fds_ptr].current_task_id = -1;
+    (*info_ptr)[*num_used_fds_ptr].num_leases = 0;
+    (*info_ptr)[*num_used_fds_ptr].avg_service_ms = 0;
+    (*info_ptr)[*num_used_fds_ptr].has_service_sample = 0;
+    (*info_ptr)[*num_used_fds_ptr].last_event_ms = 0;
+    (*info_ptr)[*num_used_fds_ptr].inbuf = inbuf;
+    (*info_ptr)[*num_used_fds_ptr].inbuf_len = 0;
+    (*info_ptr)[*num_used_fds_ptr].is_peer = 0;
 
     (*num_used_fds_ptr)++; // Zwiększenie licznika używanych deskryptorów
 
     return 0; // Sukces
 }
 
+// Obsługuje pojedynczą komendę (jedną linię protokołu, bez '\n') od workera.
+static void handle_command(int worker_idx, const char *buffer, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int num_used_fds) {
+    printf("[WM] Odebrano od workera %d: '%s'\n", (*fds_ptr)[worker_idx].fd, buffer);
+    if (strncmp(buffer, "PEER_", 5) == 0) {
+        (*info_ptr)[worker_idx].is_peer = 1;
+    }
+
+    // --- Parsowanie i obsługa komend ---
+    // Komenda: GET_TASK
+    if (strncmp(buffer, "GET_TASK", 8) == 0 && (buffer[8] == '\n' || buffer[8] == '\0')) {
+        if ((*info_ptr)[worker_idx].status == WORKER_STATUS_IDLE) {
+            char description[256];
+            unsigned int epoch;
+            int task_id = lease_next_task(&(*info_ptr)[worker_idx], &epoch, description, sizeof(description));
+
+            if (task_id != -1) {
+                char response[server_config.buffer_size];
+                snprintf(response, sizeof(response), "TASK %d %u %s\n", task_id, epoch, description);
+                send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+                printf("[WM] Przydzielono zadanie %d ('%s') workerowi %d (fd %d).\n", 
+                        task_id, description, (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
+            } else { // Brak zadań
+                send((*fds_ptr)[worker_idx].fd, "NO_TASK\n", strlen("NO_TASK\n"), 0);
+                printf("[WM] Brak zadań w kolejce dla workera %d (fd %d).\n", (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
+            }
+        } else { // Worker zajęty
+            send((*fds_ptr)[worker_idx].fd, "ERROR ALREADY_BUSY\n", strlen("ERROR ALREADY_BUSY\n"), 0);
+            printf("[WM] Worker %d (fd %d) jest już zajęty.\n", (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
+        }
+    } 
+    // Komenda: GET_TASKS <n> - prośba o n zadań w ramach okna kredytowego
+    // Odpowiedź: "GRANT <k> <okno>" i k linii "TASK <ID> <Dzierżawa> <Opis>".
+    else if (strncmp(buffer, "GET_TASKS ", 10) == 0) {
+        WorkerInfo *worker = &(*info_ptr)[worker_idx];
+        int requested = atoi(buffer + 10);
+        int credit = worker_credit(worker);
+        int available = credit - worker->num_leases;
+        if (requested > available) {
+            requested = available;
+        }
+
+        // Najpierw dzierżawa, potem wysyłka - GRANT musi poprzedzać linie TASK
+        int granted_ids[MAX_WORKER_CREDIT];
+        unsigned int granted_epochs[MAX_WORKER_CREDIT];
+        char granted_descriptions[MAX_WORKER_CREDIT][256];
+        int granted = 0;
+        while (granted < requested) {
+            int task_id = lease_next_task(worker, &granted_epochs[granted], granted_descriptions[granted], sizeof(granted_descriptions[granted]));
+            if (task_id == -1) {
+                break;
+            }
+            granted_ids[granted++] = task_id;
+        }
+        // Przejmowanie zadania od peera obsługuje w trakcie oczekiwania komendy peerów - zagnieżdżony
+        // PEER_CANCEL mógł już odwołać część dzierżaw z tej paczki. Worker dostał wtedy CANCEL
+        // nieznanego mu zadania (pomijany), więc odwołane zadania nie mogą trafić do GRANT.
+        int kept = 0;
+        for (int g = 0; g < granted; g++) {
+            if (holds_lease(worker, granted_ids[g], granted_epochs[g])) {
+                granted_ids[kept] = granted_ids[g];
+                granted_epochs[kept] = granted_epochs[g];
+                memmove(granted_descriptions[kept], granted_descriptions[g], sizeof(granted_descriptions[kept]));
+                kept++;
+            }
+        }
+        granted = kept;
+
+        // GRANT i linie TASK są wysyłane jednym zapisem - osobne małe segmenty TCP czekałyby
+        // na opóźnione potwierdzenie (algorytm Nagle'a), wydłużając cykl zadania o dziesiątki ms
+        char response[64 + MAX_WORKER_CREDIT * (sizeof(granted_descriptions[0]) + 32)];
+        int len = snprintf(response, sizeof(response), "GRANT %d %d\n", granted, credit);
+        for (int g = 0; g < granted; g++) {
+            len += snprintf(response + len, sizeof(response) - len, "TASK %d %u %s\n", granted_ids[g], granted_epochs[g], granted_descriptions[g]);
+        }
+        send((*fds_ptr)[worker_idx].fd, response, len, 0);
+        printf("[WM] Worker %d (fd %d): przydzielono %d zadań (okno %d, dzierżawy %d, śr. czas obsługi %.3f ms).\n",
+                worker->fd, (*fds_ptr)[worker_idx].fd, granted, credit, worker->num_leases, worker->avg_service_ms);
+    }
+    // Komenda: RESULT <ID> <Dzierżawa> <Wynik>
+    else if (strncmp(buffer, "RESULT ", 7) == 0) {
+        int task_id, offset = 0;
+        unsigned int epoch;
+        // Parsowanie ID zadania i numeru dzierżawy; wynik to reszta linii (ograniczona rozmiarem bufora)
+        if (sscanf(buffer, "RESULT %d %u %n", &task_id, &epoch, &offset) == 2 && offset > 0 && buffer[offset] != '\0') {
+            const char *result_str = buffer + offset;
+            printf("[WM] Odebrano wynik od workera %d (fd %d) dla zadania %d (dzierżawa %u): '%s'\n", 
+                    (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd, task_id, epoch, result_str);
+
+            // Zwolnienie miejsca w oknie workera. Wynik bez dzierżawy na tym połączeniu
+            // (np. po ponownym połączeniu workera) też jest rozpatrywany - o jego przyjęciu
+            // decyduje numer dzierżawy, a nie połączenie.
+            release_lease(&(*info_ptr)[worker_idx], task_id);
+
+            const char *response_line;
+            char response[server_config.buffer_size + 1];
+            if (CM_owns_task_id(task_id)) {
+                int outcome = TM_complete_task(task_id, epoch);
+                if (outcome == TM_RESULT_ACCEPTED && is_superseded(task_id, epoch)) {
+                    release_superseded_leases(task_id, *fds_ptr, *info_ptr, num_used_fds);
+                }
+                response_line = result_response(outcome);
+            } else { // Zadanie przejęte od peera - wynik trafia do właściciela
+                char reply[server_config.buffer_size];
+                if (CM_forward_result(task_id, epoch, result_str, reply, sizeof(reply)) == 0) {
+                    if (strcmp(reply, "OK RESULT_SUPERSEDED") == 0) {
+                        // Właściciel nie rozsyła PEER_CANCEL z obsługi komendy peera - robi to ten węzeł
+                        release_superseded_leases(task_id, *fds_ptr, *info_ptr, num_used_fds);
+                        snprintf(reply, sizeof(reply), "OK RESULT_RECEIVED");
+                    }
+                    snprintf(response, sizeof(response), "%s\n", reply);
+                } else {
+                    snprintf(response, sizeof(response), "ERROR OWNER_UNAVAILABLE\n");
+                }
+                response_line = response;
+            }
+            send((*fds_ptr)[worker_idx].fd, response_line, strlen(response_line), 0);
+        } else {
+            send((*fds_ptr)[worker_idx].fd, "ERROR INVALID_RESULT_FORMAT\n", strlen("ERROR INVALID_RESULT_FORMAT\n"), 0);
+            printf("[WM] Błąd: Nieprawidłowy format RESULT od workera %d (fd %d): '%s'\n", worker_idx, (*fds_ptr)[worker_idx].fd, buffer);
+        }
+    } 
+    // Komenda: SUBMIT [KEY=<klucz>] <opis> - zgłoszenie nowego zadania (przekazywane do węzła-właściciela)
+    else if (strncmp(buffer, "SUBMIT ", 7) == 0 || strncmp(buffer, "PEER_SUBMIT ", 12) == 0) {
+        int from_peer = (strncmp(buffer, "PEER_SUBMIT ", 12) == 0);
+        const char *args = buffer + (from_peer ? 12 : 7);
+        char key[MAX_IDEMPOTENCY_KEY];
+        char description[256];
+        char response[server_config.buffer_size + 1];
+        int has_key = (strncmp(args, "KEY=", 4) == 0);
+        int parsed;
+        if (has_key) {
+            // Klucz nie może być obcięty - obcięty klucz wskazywałby innego właściciela i inne zadanie
+            size_t key_len = strcspn(args + 4, " ");
+            parsed = key_len > 0 && key_len < sizeof(key) && args[4 + key_len] == ' ';
+            if (parsed) {
+                memcpy(key, args + 4, key_len);
+                key[key_len] = '\0';
+                parsed = (sscanf(args + 4 + key_len, " %255[^\n]", description) == 1);
+            }
+        } else {
+            parsed = (sscanf(args, "%255[^\n]", description) == 1);
+        }
+        if (!parsed) {
+            snprintf(response, sizeof(response), "ERROR INVALID_SUBMIT_FORMAT\n");
+        } else {
+            char reply[server_config.buffer_size];
+            const char *owner_key = has_key ? key : description;
+            if (!from_peer && !CM_owns_key(owner_key)) {
+                if (CM_forward_submit(has_key ? key : NULL, description, reply, sizeof(reply)) == 0) {
+                    snprintf(response, sizeof(response), "%s\n", reply);
+                    send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+                    return;
+                }
+                if (has_key) {
+                    // Zgłoszenie z kluczem musi trafić do właściciela klucza - tylko on wykrywa duplikaty
+                    send((*fds_ptr)[worker_idx].fd, "ERROR OWNER_UNAVAILABLE\n", strlen("ERROR OWNER_UNAVAILABLE\n"), 0);
+                    return;
+                }
+            }
+            // Zadanie własne lub właściciel niedostępny - ID nadane lokalnie nadal należy do tego węzła
+            int is_duplicate;
+            int task_id = TM_submit_task(has_key ? key : NULL, description, &is_duplicate);
+            if (task_id != -1) {
+                snprintf(response, sizeof(response), "OK %s %d\n", is_duplicate ? "DUPLICATE" : "SUBMITTED", task_id);
+            } else {
+                snprintf(response, sizeof(response), "ERROR QUEUE_FULL\n");
+            }
+        }
+        send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+    }
+    // Komenda: PEER_STEAL - peer prosi o oczekujące zadanie
+    else if (strncmp(buffer, "PEER_STEAL", 10) == 0 && (buffer[10] == '\n' || buffer[10] == '\0')) {
+        Task *task = TM_get_next_task();
+        if (task != NULL) {
+            char response[server_config.buffer_size];
+            task->peer_fd = (*fds_ptr)[worker_idx].fd; // Zadanie wróci do kolejki, jeśli peer się rozłączy
+            snprintf(response, sizeof(response), "TASK %d %u %s\n", task->id, task->lease_epoch, task->description);
+            send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+            printf("[WM] Zadanie %d przejęte przez peera (fd %d).\n", task->id, (*fds_ptr)[worker_idx].fd);
+        } else {
+            send((*fds_ptr)[worker_idx].fd, "NO_TASK\n", strlen("NO_TASK\n"), 0);
+        }
+    }
+    // Komendy: PEER_RESULT <ID> <Dzierżawa> <wynik> / PEER_REQUEUE <ID> <Dzierżawa> - dotyczą zadań przejętych przez peera
+    else if (strncmp(buffer, "PEER_RESULT ", 12) == 0 || strncmp(buffer, "PEER_REQUEUE ", 13) == 0) {
+        int is_result = (strncmp(buffer, "PEER_RESULT ", 12) == 0);
+        int task_id, offset = 0;
+        unsigned int epoch;
+        if (sscanf(buffer + (is_result ? 12 : 13), "%d %u %n", &task_id, &epoch, &offset) != 2) {
+            send((*fds_ptr)[worker_idx].fd, "ERROR INVALID_FORMAT\n", strlen("ERROR INVALID_FORMAT\n"), 0);
+        } else if (is_result) {
+            printf("[WM] Wynik zadania %d (dzierżawa %u) od peera (fd %d): '%s'\n", task_id, epoch, (*fds_ptr)[worker_idx].fd, buffer + 12 + offset);
+            int outcome = TM_complete_task(task_id, epoch);
+            const char *response = result_response(outcome);
+            if (outcome == TM_RESULT_ACCEPTED && is_superseded(task_id, epoch)) {
+                // Rozesłanie odwołania zostawiamy węzłowi, który przekazał wynik (bez zagnieżdżonych żądań)
+                cancel_local_leases(task_id, *fds_ptr, *info_ptr, num_used_fds);
+                response = "OK RESULT_SUPERSEDED\n";
+            }
+            send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+        } else {
+            TM_re_queue_task(task_id, epoch); // Nieaktualna dzierżawa nie cofa nowszego przydziału
+            send((*fds_ptr)[worker_idx].fd, "OK REQUEUED\n", strlen("OK REQUEUED\n"), 0);
+        }
+    }
+    // Komendy: CANCEL <ID> (od klienta) / PEER_CANCEL <ID> (rozesłane przez węzeł, który przyjął CANCEL)
+    // Anulowanie obejmuje zadania oczekujące, dzierżawione i przydzielone w paczkach (GRANT):
+    // właściciel oznacza zadanie jako CANCELLED, a każdy węzeł odwołuje dzierżawy swoich workerów.
+    else if (strncmp(buffer, "CANCEL ", 7) == 0 || strncmp(buffer, "PEER_CANCEL ", 12) == 0) {
+        int from_peer = (strncmp(buffer, "PEER_CANCEL ", 12) == 0);
+        int task_id;
+        char response[server_config.buffer_size + 1];
+        if (sscanf(buffer + (from_peer ? 12 : 7), "%d", &task_id) != 1) {
+            send((*fds_ptr)[worker_idx].fd, "ERROR INVALID_FORMAT\n", strlen("ERROR INVALID_FORMAT\n"), 0);
+            return;
+        }
+
+        cancel_local_leases(task_id, *fds_ptr, *info_ptr, num_used_fds);
+        if (CM_owns_task_id(task_id)) {
+            if (TM_cancel_task(task_id) == 0) {
+                snprintf(response, sizeof(response), "OK CANCELLED %d\n", task_id);
+            } else {
+                snprintf(response, sizeof(response), "ERROR CANNOT_CANCEL\n");
+            }
+        } else {
+            snprintf(response, sizeof(response), "OK LEASES_RELEASED %d\n", task_id);
+        }
+
+        // Rozesłanie do peerów - zadanie mogło zostać przejęte przez inny węzeł.
+        // PEER_CANCEL nie jest rozsyłany dalej, więc nie powstają zagnieżdżone żądania między węzłami.
+        if (!from_peer && CM_is_enabled()) {
+            char owner_reply[server_config.buffer_size];
+            if (CM_broadcast_cancel(task_id, owner_reply, sizeof(owner_reply)) < 0) {
+                snprintf(response, sizeof(response), "ERROR OWNER_UNAVAILABLE\n");
+            } else if (!CM_owns_task_id(task_id)) {
+                snprintf(response, sizeof(response), "%s\n", owner_reply);
+            }
+        }
+        send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+    }
+    // Komenda: POOL - wolne miejsca i pojemność puli zadań (bench dobiera do nich liczbę zgłoszeń)
+    else if (strncmp(buffer, "POOL", 4) == 0 && (buffer[4] == '\n' || buffer[4] == '\0')) {
+        char response[64];
+        snprintf(response, sizeof(response), "POOL %d %d\n", TM_free_task_slots(), server_config.max_total_tasks);
+        send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
+    }
+    // Komenda: PING (pomiar opóźnienia transportu, używana przez bench)
+    else if (strncmp(buffer, "PING", 4) == 0 && (buffer[4] == '\n' || buffer[4] == '\0')) {
+        send((*fds_ptr)[worker_idx].fd, "PONG\n", strlen("PONG\n"), 0);
+    }
+    // Nieznana komenda
+    else {
+        printf("[WM] Odebrano nieznaną komendę od deskryptora %d: '%s'\n", (*fds_ptr)[worker_idx].fd, buffer);
+        send((*fds_ptr)[worker_idx].fd, "ERROR UNKNOWN_COMMAND\n", strlen("ERROR UNKNOWN_COMMAND\n"), 0);
+    }
+}
+
+// Obsługuje wszystkie kompletne linie z bufora wejściowego połączenia - jeden odczyt może
+// zawierać kilka komend (np. RESULT i GET_TASKS wysłane razem), a komenda może być podzielona
+// między odczyty. Niekompletna końcówka pozostaje w buforze.
+static void process_input(int worker_idx, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int num_used_fds) {
+    WorkerInfo *worker = &(*info_ptr)[worker_idx];
+    int consumed = 0;
+    char *newline;
+    while ((newline = memchr(worker->inbuf + consumed, '\n', worker->inbuf_len - consumed)) != NULL) {
+        *newline = '\0';
+        handle_command(worker_idx, worker->inbuf + consumed, fds_ptr, info_ptr, num_used_fds);
+        consumed = newline - worker->inbuf + 1;
+    }
+    if (consumed == 0 && worker->inbuf_len == server_config.buffer_size - 1) {
+        // Linia dłuższa niż bufor - obsługa obciętej linii, aby nie zablokować połączenia
+        worker->inbuf[worker->inbuf_len] = '\0';
+        handle_command(worker_idx, worker->inbuf, fds_ptr, info_ptr, num_used_fds);
+        consumed = worker->inbuf_len;
+    }
+    // Przesunięcie niekompletnej końcówki na początek bufora
+    memmove(worker->inbuf, worker->inbuf + consumed, worker->inbuf_len - consumed);
+    worker->inbuf_len -= consumed;
+}
+
+// Odczytuje i obsługuje dane połączenia peera w trakcie oczekiwania na odpowiedź innego węzła.
+// Komendy workerów i klientów czekają na pętlę główną - same mogą wysyłać żądania do peerów,
+// a komendy PEER_* nigdy tego nie robią. Tablice nie są zmieniane (rozłączenie obsłuży pętla główna).
+// Zwraca 0 lub -1 (połączenie należy pominąć do końca oczekiwania).
+static int serve_peer_input(int idx) {
+    WorkerInfo *info = &(*active_info_ptr)[idx];
+    int fd = (*active_fds_ptr)[idx].fd;
+    if (!info->is_peer) {
+        char prefix[5];
+        if (info->inbuf_len > 0 || recv(fd, prefix, sizeof(prefix), MSG_PEEK | MSG_DONTWAIT) != (ssize_t)sizeof(prefix) ||
+            memcmp(prefix, "PEER_", sizeof(prefix)) != 0) {
+            return -1;
+        }
+    }
+    ssize_t valread = recv(fd, info->inbuf + info->inbuf_len, server_config.buffer_size - 1 - info->inbuf_len, MSG_DONTWAIT);
+    if (valread <= 0) {
+        return (valread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) ? 0 : -1;
+    }
+    info->inbuf_len += valread;
+    serving_peers = 1;
+    process_input(idx, active_fds_ptr, active_info_ptr, *active_num_used_fds_ptr);
+    serving_peers = 0;
+    return 0;
+}
+
+// Funkcja oczekiwania modułu klastra (CM_set_wait_function): czeka na gotowość gniazda peera fd
+// (odpowiedź lub nawiązanie połączenia), obsługując w tym czasie żądania PEER_* od innych węzłów. Bez tego dwa węzły wysyłające do siebie
+// żądania jednocześnie (np. oba przejmujące zadania) czekałyby na siebie do upływu limitu czasu.
+// Nowe połączenia są przyjmowane tylko bez realokacji tablic - wywołujący trzymają do nich wskaźniki.
+static int wait_serving_peers(int fd, short events, int timeout_ms) {
+    if (serving_peers || active_fds_ptr == NULL || active_worker_idx == -1) {
+        struct pollfd pfd = { .fd = fd, .events = events };
+        int ready = poll(&pfd, 1, timeout_ms);
+        return (ready < 0 && errno == EINTR) ? 1 : ready;
+    }
+
+    int capacity = *active_capacity_ptr; // Stała w trakcie oczekiwania (brak realokacji)
+    struct pollfd pfds[capacity + 1];
+    int indices[capacity + 1];
+    char skipped[capacity]; // Połączenia pominięte do końca oczekiwania
+    memset(skipped, 0, sizeof(skipped));
+    long long deadline = (long long)now_ms() + timeout_ms;
+    for (;;) {
+        int num_fds = *active_num_used_fds_ptr;
+        int count = 0;
+        pfds[count].fd = fd;
+        pfds[count++].events = events;
+        for (int i = 0; i < num_fds; i++) {
+            int client_fd = (*active_fds_ptr)[i].fd;
+            if (i == active_worker_idx || skipped[i] || client_fd == -1 ||
+                (WM_is_listening_fd(client_fd) && num_fds == capacity)) {
+                continue;
+            }
+            indices[count] = i;
+            pfds[count].fd = client_fd;
+            pfds[count++].events = POLLIN;
+        }
+
+        long long remaining = deadline - (long long)now_ms();
+        if (remaining <= 0) {
+            return 0;
+        }
+        int ready = poll(pfds, count, (int)remaining);
+        if (ready <= 0) {
+            return (ready < 0 && errno == EINTR) ? 1 : ready;
+        }
+        if (pfds[0].revents != 0) {
+            return 1; // Odpowiedź, połączenie lub rozłączenie peera
+        }
+        for (int k = 1; k < count; k++) {
+            if (pfds[k].revents == 0) {
+                continue;
+            }
+            if (WM_is_listening_fd(pfds[k].fd)) {
+                if (*active_num_used_fds_ptr < capacity) {
+                    WM_handle_new_connection(pfds[k].fd, active_fds_ptr, active_info_ptr, active_num_used_fds_ptr, active_capacity_ptr);
+                }
+            } else if (serve_peer_input(indices[k]) < 0) {
+                skipped[indices[k]] = 1;
+            }
+        }
+    }
+}
+
 // Obsługuje dane od istniejącego workera lub jego rozłączenie.
 int WM_handle_worker_data(int worker_idx, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int *num_used_fds_ptr, int *current_capacity_ptr) {
-    char buffer[BUFFER_SIZE];
-    // Odczyt danych z gniazda
-    int valread = read((*fds_ptr)[worker_idx].fd, buffer, BUFFER_SIZE - 1);
+    WorkerInfo *reader = &(*info_ptr)[worker_idx];
+    active_fds_ptr = fds_ptr;
+    active_info_ptr = info_ptr;
+    active_num_used_fds_ptr = num_used_fds_ptr;
+    active_capacity_ptr = current_capacity_ptr;
+    active_worker_idx = worker_idx;
+    // Odczyt danych z gniazda do bufora wejściowego workera (za niekompletną poprzednią linią).
+    // Bez blokowania - dane zgłoszone przez poll() mogły zostać już odczytane przez wait_serving_peers.
+    int valread = recv((*fds_ptr)[worker_idx].fd, reader->inbuf + reader->inbuf_len, server_config.buffer_size - 1 - reader->inbuf_len, MSG_DONTWAIT);
+    if (valread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        active_worker_idx = -1;
+        return 0; // Brak nowych danych
+    }
 
     // Obsługa rozłączenia lub błędu odczytu
     if (valread <= 0) {
@@ -180,14 +801,24 @@ int WM_handle_worker_data(int worker_idx, struct pollfd **fds_ptr, WorkerInfo **
             printf("[WM] Błąd odczytu na deskryptorze %d. Zamykam połączenie.\n", (*fds_ptr)[worker_idx].fd);
         }
 
-        // Re-kolejkowanie zadania, jeśli worker był zajęty
-        if ((*info_ptr)[worker_idx].status == WORKER_STATUS_BUSY && (*info_ptr)[worker_idx].current_task_id != -1) {
+        // Re-kolejkowanie wszystkich zadań dzierżawionych przez workera
+        for (int l = 0; l < (*info_ptr)[worker_idx].num_leases; l++) {
+            int task_id = (*info_ptr)[worker_idx].leased_task_ids[l];
+            unsigned int epoch = (*info_ptr)[worker_idx].leased_epochs[l];
             printf("[WM] Worker %d (fd %d) rozłączył się w trakcie zadania %d. Próba re-kolejkowania.\n",
-                    (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd, (*info_ptr)[worker_idx].current_task_id);
-            TM_re_queue_task((*info_ptr)[worker_idx].current_task_id);
+                    (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd, task_id);
+            if (CM_owns_task_id(task_id)) {
+                TM_re_queue_task(task_id, epoch);
+            } else if (CM_forward_requeue(task_id, epoch) < 0) {
+                printf("[WM] Ostrzeżenie: Nie można zwrócić zadania %d do węzła-właściciela.\n", task_id);
+            }
         }
+        // Jeśli rozłączył się peer klastra - re-kolejkowanie przejętych przez niego zadań
+        TM_re_queue_peer_tasks((*fds_ptr)[worker_idx].fd);
+        active_worker_idx = -1;
 
         close((*fds_ptr)[worker_idx].fd); // Zamknięcie gniazda
+        free((*info_ptr)[worker_idx].inbuf);
 
         // Kompaktowanie tablic (przesunięcie ostatniego elementu)
         if (worker_idx != *num_used_fds_ptr - 1) {
@@ -197,16 +828,17 @@ int WM_handle_worker_data(int worker_idx, struct pollfd **fds_ptr, WorkerInfo **
         (*num_used_fds_ptr)--;
 
         // Opcjonalne zmniejszanie alokacji pamięci
-        if (*num_used_fds_ptr < *current_capacity_ptr - REALLOC_INCREMENT && *current_capacity_ptr > INITIAL_CAPACITY) {
-            printf("[WM] Zmniejszam alokację tablic: %d -> %d\n", *current_capacity_ptr, *current_capacity_ptr - REALLOC_INCREMENT);
-            *current_capacity_ptr -= REALLOC_INCREMENT;
+        int increment = server_config.realloc_increment;
+        if (*num_used_fds_ptr < *current_capacity_ptr - increment && *current_capacity_ptr > server_config.initial_capacity) {
+            printf("[WM] Zmniejszam alokację tablic: %d -> %d\n", *current_capacity_ptr, *current_capacity_ptr - increment);
+            *current_capacity_ptr -= increment;
             
             struct pollfd *temp_fds_shrink = (struct pollfd *)realloc(*fds_ptr, *current_capacity_ptr * sizeof(struct pollfd));
             WorkerInfo *temp_worker_infos_shrink = (WorkerInfo *)realloc(*info_ptr, *current_capacity_ptr * sizeof(WorkerInfo));
             
             if (temp_fds_shrink == NULL || temp_worker_infos_shrink == NULL) {
                 perror("[WM] realloc (shrink) failed, continuing with larger array");
-                *current_capacity_ptr += REALLOC_INCREMENT; // Przywrócenie pojemności w razie błędu
+                *current_capacity_ptr += increment; // Przywrócenie pojemności w razie błędu
             } else {
                 *fds_ptr = temp_fds_shrink;
                 *info_ptr = temp_worker_infos_shrink;
@@ -214,72 +846,10 @@ int WM_handle_worker_data(int worker_idx, struct pollfd **fds_ptr, WorkerInfo **
         }
         return 1; // Sygnalizacja usunięcia workera
     } else { // Odebrano dane od workera (valread > 0)
-        buffer[valread] = '\0'; // Zakończenie stringa
-        printf("[WM] Odebrano od workera %d: '%s'\n", (*fds_ptr)[worker_idx].fd, buffer);
-
-        // --- Parsowanie i obsługa komend ---
-        // Komenda: GET_TASK
-        if (strncmp(buffer, "GET_TASK", 8) == 0 && (buffer[8] == '\n' || buffer[8] == '\0')) {
-            if ((*info_ptr)[worker_idx].status == WORKER_STATUS_IDLE) {
-                Task *task = TM_get_next_task(); // Pobranie zadania
-                if (task != NULL) {
-                    (*info_ptr)[worker_idx].status = WORKER_STATUS_BUSY;
-                    (*info_ptr)[worker_idx].current_task_id = task->id;
-
-                    char response[BUFFER_SIZE];
-                    snprintf(response, BUFFER_SIZE, "TASK %d %s\n", task->id, task->description);
-                    send((*fds_ptr)[worker_idx].fd, response, strlen(response), 0);
-                    printf("[WM] Przydzielono zadanie %d ('%s') workerowi %d (fd %d).\n", 
-                            task->id, task->description, (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
-                } else { // Brak zadań
-                    send((*fds_ptr)[worker_idx].fd, "NO_TASK\n", strlen("NO_TASK\n"), 0);
-                    printf("[WM] Brak zadań w kolejce dla workera %d (fd %d).\n", (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
-                }
-            } else { // Worker zajęty
-                send((*fds_ptr)[worker_idx].fd, "ERROR ALREADY_BUSY\n", strlen("ERROR ALREADY_BUSY\n"), 0);
-                printf("[WM] Worker %d (fd %d) jest już zajęty.\n", (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd);
-            }
-        } 
-        // Komenda: RESULT
-        else if (strncmp(buffer, "RESULT ", 7) == 0) {
-            int task_id;
-            char result_str[BUFFER_SIZE]; 
-            // Parsowanie ID zadania i wyniku, z ograniczeniem długości
-            if (sscanf(buffer, "RESULT %d %1023[^\n]", &task_id, result_str) == 2) {
-                printf("[WM] Odebrano wynik od workera %d (fd %d) dla zadania %d: '%s'\n", 
-                        (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd, task_id, result_str);
-                
-                // Weryfikacja ID zadania i statusu workera
-                if ((*info_ptr)[worker_idx].status == WORKER_STATUS_BUSY && (*info_ptr)[worker_idx].current_task_id == task_id) {
-                    printf("[WM] Zadanie %d zakończone przez workera %d. Wynik: '%s'\n", task_id, (*info_ptr)[worker_idx].fd, result_str);
-                    (*info_ptr)[worker_idx].status = WORKER_STATUS_IDLE;
-                    (*info_ptr)[worker_idx].current_task_id = -1;
-                    
-                    Task *completed_task = TM_find_task_by_id(task_id);
-                    if (completed_task != NULL) {
-                        completed_task->status = TASK_STATUS_COMPLETED;
-                        printf("[TASK_MANAGER] Zadanie %d ('%s') status: COMPLETED.\n", completed_task->id, completed_task->description);
-                    } else {
-                        printf("[WM] Ostrzeżenie: Wynik dla zadania %d, nie znaleziono w puli.\n", task_id);
-                    }
-
-                    send((*fds_ptr)[worker_idx].fd, "OK RESULT_RECEIVED\n", strlen("OK RESULT_RECEIVED\n"), 0);
-                } else {
-                    send((*fds_ptr)[worker_idx].fd, "ERROR INVALID_TASK_ID_OR_NOT_BUSY\n", strlen("ERROR INVALID_TASK_ID_OR_NOT_BUSY\n"), 0);
-                    printf("[WM] Błąd: Worker %d (fd %d) odesłał wynik dla niepoprawnego zadania %d (oczekiwano %d).\n", 
-                            (*info_ptr)[worker_idx].fd, (*fds_ptr)[worker_idx].fd, task_id, (*info_ptr)[worker_idx].current_task_id);
-                }
-            } else {
-                send((*fds_ptr)[worker_idx].fd, "ERROR INVALID_RESULT_FORMAT\n", strlen("ERROR INVALID_RESULT_FORMAT\n"), 0);
-                printf("[WM] Błąd: Nieprawidłowy format RESULT od workera %d (fd %d): '%s'\n", worker_idx, (*fds_ptr)[worker_idx].fd, buffer);
-            }
-        } 
-        // Nieznana komenda
-        else {
-            printf("[WM] Odebrano nieznaną komendę od deskryptora %d: '%s'\n", (*fds_ptr)[worker_idx].fd, buffer);
-            send((*fds_ptr)[worker_idx].fd, "ERROR UNKNOWN_COMMAND\n", strlen("ERROR UNKNOWN_COMMAND\n"), 0);
-        }
+        (*info_ptr)[worker_idx].inbuf_len += valread;
+        process_input(worker_idx, fds_ptr, info_ptr, *num_used_fds_ptr);
     }
+    active_worker_idx = -1;
     return 0; // Sukces, worker aktywny
 }
 
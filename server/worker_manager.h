@@ -6,20 +6,23 @@
 
 // Interfejs modułu zarządzania połączeniami workerów i ich stanem.
 
-// Inicjuje menedżer workerów, tworzy gniazdo nasłuchujące.
+// Inicjuje menedżer workerów, tworzy gniazda nasłuchujące (TCP na danym porcie oraz AF_UNIX).
 // Alokuje początkowe tablice dla połączeń.
-// Zwraca deskryptor gniazda nasłuchującego lub -1 w przypadku błędu.
+// Zwraca deskryptor gniazda nasłuchującego TCP lub -1 w przypadku błędu.
 // Aktualizuje wskaźniki fds_ptr i info_ptr.
-int WM_init_manager(struct pollfd **fds_ptr, WorkerInfo **info_ptr);
+int WM_init_manager(int port, struct pollfd **fds_ptr, WorkerInfo **info_ptr);
 
-// Zamyka aktywne połączenia workerów i zwalnia zaalokowaną pamięć.
+// Zamyka aktywne połączenia workerów, gniazdo AF_UNIX i zwalnia zaalokowaną pamięć.
 void WM_cleanup_manager(int server_fd, struct pollfd *fds, WorkerInfo *info);
 
-// Obsługuje nowe połączenie od workera.
+// Sprawdza, czy deskryptor jest jednym z gniazd nasłuchujących (TCP lub AF_UNIX).
+int WM_is_listening_fd(int fd);
+
+// Obsługuje nowe połączenie od workera na danym gnieździe nasłuchującym.
 // Akceptuje połączenie i dodaje workera do tablic monitorowania.
 // Zwraca 0 (sukces) lub -1 (błąd).
 // Aktualizuje wskaźniki i liczniki.
-int WM_handle_new_connection(int server_fd, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int *num_used_fds_ptr, int *current_capacity_ptr);
+int WM_handle_new_connection(int listen_fd, struct pollfd **fds_ptr, WorkerInfo **info_ptr, int *num_used_fds_ptr, int *current_capacity_ptr);
 
 // Obsługuje dane od istniejącego workera lub jego rozłączenie.
 // Zawiera logikę parsowania protokołu i re-kolejkowania zadań.
@@ -1,15 +1,94 @@
+#define _GNU_SOURCE      // Dla ppoll()
 #include <stdio.h>       // Standardowe wejście/wyjście (printf, perror, fgets)
 #include <stdlib.h>      // Standardowe funkcje ogólnego przeznaczenia (exit)
 #include <string.h>      // Funkcje do manipulacji stringami i pamięcią (memset, strncpy, strncmp, strchr, strrchr, strcspn)
-#include <unistd.h>      // Funkcje POSIX (close, read, sleep)
+#include <unistd.h>      // Funkcje POSIX (close, read)
 #include <sys/socket.h>  // Podstawowe definicje funkcji gniazd
+#include <sys/un.h>      // Definicje adresów gniazd AF_UNIX
 #include <netinet/in.h>  // Definicje struktur adresów internetowych
 #include <arpa/inet.h>   // Funkcje do konwersji adresów IP
 #include <errno.h>       // Dla stałej EINTR (używanej w read_line)
+#include <poll.h>        // Sprawdzanie dostępności danych bez blokowania (poll)
+#include <time.h>        // Pomiar czasu (clock_gettime)
+#include <math.h>        // Zaokrąglanie okna potoku (ceil)
+#include <signal.h>      // Przeładowanie konfiguracji (SIGHUP)
 
-#define SERVER_IP "127.0.0.1" // Adres IP serwera
-#define PORT 8080             // Port serwera
-#define BUFFER_SIZE 1024
+#include "config.h"      // Konfiguracja uruchomieniowa (wspólna z serwerem)
+#include "common_defs.h" // Wartości domyślne i stałe wspólne z serwerem
+
+#define MAX_WINDOW MAX_WORKER_CREDIT // Górna granica ustawienia max_window (serwer nie przyzna większego okna)
+#define ENV_PREFIX "WM_WORKER_" // Prefiks zmiennych środowiskowych workera (np. WM_WORKER_PORT)
+
+// Ustawienia workera (wartości domyślne poniżej).
+typedef struct {
+    char host[64];           // Adres IP serwera
+    int port;                // Port serwera
+    int use_unix;            // 1 - połączenie przez gniazdo AF_UNIX
+    char unix_socket[108];   // Ścieżka gniazda AF_UNIX ("" - wg portu)
+    int buffer_size;         // Rozmiar bufora linii protokołu
+    int max_window;          // Maksymalna liczba zadań w lokalnym potoku (live)
+    double ewma_weight;      // Waga nowej próbki w średnich kroczących (live)
+    int no_task_backoff_sec; // Odstęp między prośbami, gdy serwer nie ma zadań (live)
+    int cancel_check_ms;     // Co ile ms wykonywane zadanie sprawdza, czy nie nadeszło anulowanie (live)
+} WorkerConfig;
+
+static WorkerConfig config = {
+    .host = DEFAULT_HOST,
+    .port = DEFAULT_PORT,
+    .use_unix = 0,
+    .unix_socket = "",
+    .buffer_size = DEFAULT_BUFFER_SIZE,
+    .max_window = MAX_WINDOW,
+    .ewma_weight = DEFAULT_EWMA_WEIGHT,
+    .no_task_backoff_sec = 3,
+    .cancel_check_ms = 100,
+};
+
+static ConfigOption worker_options[] = {
+    { "host", CFG_STRING, config.host, sizeof(config.host), 0, 0, 0, "adres IP serwera", 0 },
+    { "port", CFG_INT, &config.port, 0, 1, 65535, 0, "port serwera (dowolny węzeł klastra)", 0 },
+    { "use_unix", CFG_INT, &config.use_unix, 0, 0, 1, 0, "połączenie przez gniazdo AF_UNIX (0/1)", 0 },
+    { "unix_socket", CFG_STRING, config.unix_socket, sizeof(config.unix_socket), 0, 0, 0, "ścieżka gniazda AF_UNIX (puste - wg portu)", 0 },
+    { "buffer_size", CFG_INT, &config.buffer_size, 0, 512, 65536, 0, "rozmiar bufora linii protokołu", 0 },
+    { "max_window", CFG_INT, &config.max_window, 0, 1, MAX_WINDOW, 1, "maksymalna liczba zadań w potoku", 0 },
+    { "ewma_weight", CFG_DOUBLE, &config.ewma_weight, 0, 0.01, 1, 1, "waga nowej próbki w średnich kroczących", 0 },
+    { "no_task_backoff_sec", CFG_INT, &config.no_task_backoff_sec, 0, 0, 3600, 1, "odstęp między prośbami, gdy brak zadań", 0 },
+    { "cancel_check_ms", CFG_INT, &config.cancel_check_ms, 0, 1, 10000, 1, "okres sprawdzania anulowania zadania", 0 },
+};
+#define NUM_WORKER_OPTIONS ((int)(sizeof(worker_options) / sizeof(worker_options[0])))
+
+// Ustawiana przez SIGHUP; konfiguracja jest przeładowywana po przerwaniu oczekiwania (wait_for_server).
+static volatile sig_atomic_t reload_requested = 0;
+static sigset_t wait_mask; // Maska sygnałów na czas oczekiwania (SIGHUP odblokowany)
+
+// Zadanie wydzierżawione od serwera, oczekujące w lokalnym potoku.
+typedef struct {
+    int id;
+    unsigned int epoch;     // Numer dzierżawy - odsyłany z wynikiem
+    char description[256];
+} LeasedTask;
+
+// --- Stan potoku zadań ---
+static LeasedTask task_queue[MAX_WINDOW]; // Kolejka cykliczna wydzierżawionych zadań
+static int queue_head = 0;
+static int queue_count = 0;
+static int expected_tasks = 0;      // Liczba linii TASK zapowiedzianych przez GRANT, jeszcze nieodebranych
+static int request_in_flight = 0;   // Czy wysłano GET_TASKS bez odpowiedzi GRANT
+static double request_sent_ms = 0;
+static int server_credit = 1;       // Okno kredytowe przyznane przez serwer
+static int no_tasks_available = 0;  // Ostatni GRANT nie przydzielił zadań, a potok jest pusty
+static double avg_exec_ms = 0;      // Średnia krocząca czasu wykonania zadania (0 - brak pomiarów)
+static double avg_rtt_ms = 0;       // Średnia krocząca czasu GET_TASKS -> GRANT (0 - brak pomiarów)
+
+// --- Stan połączenia i bieżącego zadania ---
+static int client_fd = -1;
+static int current_task_id = -1;    // ID wykonywanego zadania (-1 - brak)
+static int cancel_requested = 0;    // Serwer anulował wykonywane zadanie
+static int connection_closed = 0;   // Serwer rozłączył się w trakcie wykonywania zadania
+static char config_path[512] = "";  // Plik konfiguracyjny (--config lub WM_WORKER_CONFIG)
+
+static void handle_server_line(const char *line, int waiting);
+static int wait_for_server(int timeout_ms);
 
 // --- Funkcje pomocnicze ---
 
@@ -65,6 +144,50 @@ ssize_t read_line(int fd, void *buffer, size_t n) {
     return totRead;
 }
 
+// Zwraca bieżący czas monotoniczny w milisekundach (z częścią ułamkową - RTT lokalnie to ułamki ms).
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * Symuluje pracę trwającą podaną liczbę sekund, obsługując w tym czasie linie od serwera.
+ * Praca jest dzielona na odcinki cancel_check_ms, więc anulowanie (CANCEL) przerywa ją
+ * w punkcie kontrolnym zamiast po zakończeniu zadania.
+ *
+ * @param seconds Czas pracy w sekundach.
+ * @return 0 jeśli praca zakończyła się, -1 jeśli zadanie anulowano lub serwer się rozłączył.
+ */
+static int simulate_work(int seconds) {
+    double deadline = now_ms() + seconds * 1000.0;
+    char line[config.buffer_size];
+
+    for (;;) {
+        if (cancel_requested || connection_closed) {
+            return -1;
+        }
+        double remaining = deadline - now_ms();
+        if (remaining <= 0) {
+            return 0;
+        }
+        if (wait_for_server(remaining < config.cancel_check_ms ? (int)remaining + 1 : config.cancel_check_ms) <= 0) {
+            continue; // Punkt kontrolny (także po SIGHUP)
+        }
+        ssize_t valread = read_line(client_fd, line, sizeof(line));
+        if (valread <= 0) {
+            printf("[WORKER] Serwer rozłączył się w trakcie wykonywania zadania.\n");
+            connection_closed = 1;
+            return -1;
+        }
+        line[strcspn(line, "\n")] = 0;
+        if (strlen(line) > 0) {
+            printf("[SERVER->WORKER] Odebrano: '%s'\n", line);
+            handle_server_line(line, 0);
+        }
+    }
+}
+
 /**
  * Symuluje wykonanie zadania na podstawie jego opisu.
  * 
@@ -72,10 +195,13 @@ ssize_t read_line(int fd, void *buffer, size_t n) {
  * @param description Opis zadania.
  * @param result_buffer Bufor na wynik.
  * @param buffer_size Rozmiar bufora na wynik.
+ * @return 0 jeśli zadanie wykonano, -1 jeśli zostało przerwane (anulowanie lub rozłączenie).
  */
-void execute_task(int task_id, const char *description, char *result_buffer, int buffer_size) {
+int execute_task(int task_id, const char *description, char *result_buffer, int buffer_size) {
     printf("[WORKER] Wykonuję zadanie %d: '%s'\n", task_id, description);
-    sleep(5); // Symulacja czasu przetwarzania
+    if (simulate_work(5) < 0) { // Symulacja czasu przetwarzania
+        return -1;
+    }
     // Symulacja zadania: Odwracanie stringa (format: "REVERSE 'string'")
     if (strncmp(description, "REVERSE '", 9) == 0) {
         const char *content_start = description + 9; // Wskaźnik za "REVERSE '"
@@ -116,123 +242,394 @@ void execute_task(int task_id, const char *description, char *result_buffer, int
     }
     // Domyślna symulacja dla nieznanych zadań
     else {
-        sleep(1); // Symulacja pracy
+        if (simulate_work(1) < 0) { // Symulacja pracy
+            return -1;
+        }
         snprintf(result_buffer, buffer_size, "Completed unknown task: %s", description);
     }
     printf("[WORKER] Zadanie %d zakończono.\n", task_id);
+    return 0;
 }
 
-// --- Główna funkcja klienta (workera) ---
-int main() {
-    int client_fd;
+/**
+ * Nawiązuje połączenie z serwerem przez TCP.
+ *
+ * @param port Port serwera (dowolnego węzła klastra).
+ * @return Deskryptor połączonego gniazda lub -1 w przypadku błędu.
+ */
+int connect_tcp(int port) {
+    int fd;
     struct sockaddr_in serv_addr;
-    char buffer[BUFFER_SIZE] = {0};
-    ssize_t valread;
-    int keep_running = 1; // Flaga do kontrolowania głównej pętli
-
-    // --- Inicjalizacja połączenia sieciowego ---
 
-    // 1. Tworzenie gniazda
-    if ((client_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
         perror("socket creation error");
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
-    // 2. Konfiguracja adresu serwera
+    memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(PORT);
+    serv_addr.sin_port = htons(port);
 
-    // 3. Konwersja adresu IP z tekstu na format binarny
-    if (inet_pton(AF_INET, SERVER_IP, &serv_addr.sin_addr) <= 0) {
+    // Konwersja adresu IP z tekstu na format binarny
+    if (inet_pton(AF_INET, config.host, &serv_addr.sin_addr) <= 0) {
         printf("\nInvalid address/ Address not supported \n");
-        close(client_fd); // Zamknięcie gniazda przed wyjściem
-        exit(EXIT_FAILURE);
+        close(fd);
+        return -1;
     }
 
-    // 4. Nawiązywanie połączenia z serwerem (blokujące)
-    printf("[WORKER] Próbuję połączyć się z serwerem %s:%d\n", SERVER_IP, PORT);
-    if (connect(client_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+    printf("[WORKER] Próbuję połączyć się z serwerem %s:%d\n", config.host, port);
+    if (connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
         perror("connection failed");
-        close(client_fd); // Zamknięcie gniazda przed wyjściem
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Nawiązuje połączenie z serwerem przez gniazdo AF_UNIX (worker na tym samym hoście).
+ * Komunikaty omijają wtedy stos TCP.
+ *
+ * @param path Ścieżka gniazda serwera.
+ * @return Deskryptor połączonego gniazda lub -1 w przypadku błędu.
+ */
+int connect_unix(const char *path) {
+    int fd;
+    struct sockaddr_un serv_addr;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        perror("unix socket creation error");
+        return -1;
+    }
+
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sun_family = AF_UNIX;
+    strncpy(serv_addr.sun_path, path, sizeof(serv_addr.sun_path) - 1);
+
+    printf("[WORKER] Próbuję połączyć się z serwerem przez gniazdo %s\n", path);
+    if (connect(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("unix connection failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Aktualizuje średnią kroczącą o nową próbkę.
+static void update_ewma(double *avg, double sample) {
+    *avg = *avg <= 0 ? sample : config.ewma_weight * sample + (1 - config.ewma_weight) * *avg;
+}
+
+/**
+ * Wyznacza docelową liczbę wydzierżawionych zadań (bieżące + oczekujące).
+ * Potok musi ukryć czas odpowiedzi serwera: w trakcie wykonywania jednego zadania
+ * nadchodzą kolejne, więc potrzeba 1 + ceil(RTT / czas_zadania) zadań.
+ * Okno jest ograniczone ustawieniem max_window i kredytem przyznanym przez serwer.
+ */
+static int desired_window() {
+    int window = 1;
+    if (avg_exec_ms > 0 && avg_rtt_ms > 0) {
+        window = 1 + (int)ceil(avg_rtt_ms / avg_exec_ms); // Czasy w ułamkach ms (zadania krótsze niż 1 ms)
+    } else if (avg_rtt_ms > 0) {
+        window = 2; // Brak pomiaru czasu zadania - jedno zadanie na zapas
+    }
+    if (window > config.max_window) window = config.max_window;
+    if (window > server_credit) window = server_credit;
+    return window < 1 ? 1 : window;
+}
+
+/**
+ * Obsługuje jedną linię odebraną od serwera (bez '\n').
+ *
+ * @param line Linia protokołu.
+ * @param waiting Czy worker był bezczynny w oczekiwaniu na odpowiedź (wtedy pomiar RTT jest wiarygodny).
+ */
+static void handle_server_line(const char *line, int waiting) {
+    int granted, credit;
+    if (sscanf(line, "GRANT %d %d", &granted, &credit) == 2) {
+        // Odpowiedź na GET_TASKS: liczba przydzielonych zadań i okno kredytowe serwera
+        if (waiting) {
+            update_ewma(&avg_rtt_ms, now_ms() - request_sent_ms);
+        }
+        request_in_flight = 0;
+        server_credit = credit;
+        expected_tasks += granted;
+        no_tasks_available = (granted == 0 && queue_count == 0);
+    } else if (strncmp(line, "TASK ", 5) == 0) {
+        LeasedTask *slot = &task_queue[(queue_head + queue_count) % MAX_WINDOW];
+        if (expected_tasks > 0) {
+            expected_tasks--;
+        }
+        // Użycie %255[^\n] zapobiega przepełnieniu bufora description
+        if (queue_count < MAX_WINDOW && sscanf(line, "TASK %d %u %255[^\n]", &slot->id, &slot->epoch, slot->description) == 3) {
+            queue_count++;
+        } else {
+            printf("[WORKER] Błąd parsowania zadania: %s\n", line);
+        }
+    } else if (strncmp(line, "CANCEL ", 7) == 0) {
+        // Niezamówione anulowanie zadania: wykonywane jest przerywane w najbliższym punkcie
+        // kontrolnym, a oczekujące w potoku (np. z paczki GRANT) jest z niego usuwane
+        int task_id;
+        if (sscanf(line, "CANCEL %d", &task_id) != 1) {
+            printf("[WORKER] Błąd parsowania anulowania: %s\n", line);
+            return;
+        }
+        if (task_id == current_task_id) {
+            printf("[WORKER] Anulowano wykonywane zadanie %d.\n", task_id);
+            cancel_requested = 1;
+            return;
+        }
+        int kept = 0;
+        for (int i = 0; i < queue_count; i++) {
+            LeasedTask *task = &task_queue[(queue_head + i) % MAX_WINDOW];
+            if (task->id == task_id) {
+                printf("[WORKER] Usunięto anulowane zadanie %d z potoku.\n", task_id);
+                continue;
+            }
+            task_queue[(queue_head + kept) % MAX_WINDOW] = *task;
+            kept++;
+        }
+        queue_count = kept;
+    } else if (strncmp(line, "OK ", 3) == 0) { // Obsługa potwierdzeń (np. OK RESULT_RECEIVED)
+        printf("[WORKER] Otrzymano potwierdzenie od serwera: '%s'.\n", line);
+    } else if (strncmp(line, "ERROR ", 6) == 0) { // Obsługa błędów od serwera
+        printf("[WORKER] Serwer zwrócił błąd: '%s'.\n", line);
+    } else {
+        printf("[WORKER] Odebrano nieznaną odpowiedź od serwera: '%s'. Ignoruję.\n", line);
+    }
+}
+
+static void handle_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+// Przeładowuje plik konfiguracyjny po SIGHUP (zmieniają się tylko ustawienia live).
+static void reload_config() {
+    if (config_path[0] == '\0') {
+        printf("[WORKER] SIGHUP: brak pliku konfiguracyjnego (--config), nic do przeładowania.\n");
+        return;
+    }
+    printf("[WORKER] SIGHUP: przeładowanie konfiguracji z '%s'.\n", config_path);
+    if (CFG_reload_file(worker_options, NUM_WORKER_OPTIONS, config_path) < 0) {
+        printf("[WORKER] Przeładowanie nieudane - konfiguracja bez zmian.\n");
+    }
+}
+
+/**
+ * Czeka co najwyżej timeout_ms (-1 - bez limitu) na dane od serwera.
+ * SIGHUP jest zablokowany poza tym oczekiwaniem, a ppoll() atomowo przywraca pierwotną maskę,
+ * więc sygnał zawsze przerywa oczekiwanie (także nadesłany tuż przed nim), a konfiguracja
+ * jest przeładowywana od razu - również w trakcie wykonywania zadania.
+ *
+ * @param timeout_ms Limit czasu w milisekundach.
+ * @return >0 jeśli nadeszły dane, 0 (limit czasu lub przeładowanie po SIGHUP), -1 w przypadku błędu.
+ */
+static int wait_for_server(int timeout_ms) {
+    struct pollfd pfd = { .fd = client_fd, .events = POLLIN };
+    struct timespec timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    int ready = ppoll(&pfd, 1, timeout_ms < 0 ? NULL : &timeout, &wait_mask);
+    if (ready < 0 && errno == EINTR) {
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_config();
+        }
+        return 0;
+    }
+    return ready;
+}
+
+/**
+ * Odczekuje podaną liczbę sekund (odstęp, gdy serwer nie ma zadań).
+ * Jak wait_for_server, przeładowuje konfigurację po SIGHUP, ale nie przerywa odczekiwania
+ * na dane od serwera (np. niezamówione CANCEL) - zostaną odczytane po jego zakończeniu.
+ */
+static void backoff(int seconds) {
+    double deadline = now_ms() + seconds * 1000.0;
+    double remaining;
+    while ((remaining = deadline - now_ms()) > 0) {
+        struct timespec timeout = { (time_t)(remaining / 1000), (long)((long long)remaining % 1000) * 1000000L };
+        if (ppoll(NULL, 0, &timeout, &wait_mask) < 0 && errno == EINTR && reload_requested) {
+            reload_requested = 0;
+            reload_config();
+        }
+    }
+}
+
+// --- Główna funkcja klienta (workera) ---
+// Użycie: ./worker [--config plik] [--unix [path]] [--<ustawienie> wartość]...
+//   --unix [path] - połączenie przez gniazdo AF_UNIX (domyślnie ścieżka wg portu)
+// Kolejność źródeł ustawień: wiersz poleceń > zmienne WM_WORKER_* > plik konfiguracyjny > wartości domyślne.
+int main(int argc, char *argv[]) {
+    ssize_t valread;
+    int keep_running = 1; // Flaga do kontrolowania głównej pętli
+
+    // --- Konfiguracja: plik (--config lub WM_WORKER_CONFIG), środowisko, argumenty ---
+    if (getenv(ENV_PREFIX "CONFIG") != NULL) {
+        snprintf(config_path, sizeof(config_path), "%s", getenv(ENV_PREFIX "CONFIG"));
+    }
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0) {
+            snprintf(config_path, sizeof(config_path), "%s", argv[i + 1]);
+        }
+    }
+    if ((config_path[0] != '\0' && CFG_load_file(worker_options, NUM_WORKER_OPTIONS, config_path) < 0) ||
+        CFG_load_env(worker_options, NUM_WORKER_OPTIONS, ENV_PREFIX) < 0) {
+        fprintf(stderr, "[WORKER] Błąd konfiguracji. Zamykam.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            i++;
+        } else if (strcmp(argv[i], "--unix") == 0) {
+            CFG_set(worker_options, NUM_WORKER_OPTIONS, "use_unix", "1", CFG_SOURCE_CLI);
+            if (i + 1 < argc && argv[i + 1][0] != '-' &&
+                CFG_set(worker_options, NUM_WORKER_OPTIONS, "unix_socket", argv[i + 1], CFG_SOURCE_CLI) == 0) {
+                i++;
+            }
+        } else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc &&
+                   CFG_set(worker_options, NUM_WORKER_OPTIONS, argv[i] + 2, argv[i + 1], CFG_SOURCE_CLI) == 0) {
+            i++;
+        } else {
+            fprintf(stderr, "Użycie: %s [--config plik] [--unix [path]] [--<ustawienie> wartość]...\n", argv[0]);
+            fprintf(stderr, "Ustawienia (także w pliku jako 'klucz = wartość' i w zmiennych %s<KLUCZ>):\n", ENV_PREFIX);
+            CFG_print_usage(worker_options, NUM_WORKER_OPTIONS);
+            exit(EXIT_FAILURE);
+        }
+    }
+    CFG_dump(worker_options, NUM_WORKER_OPTIONS, "[WORKER]");
+
+    // SIGHUP jest dostarczany tylko w trakcie oczekiwania na serwer (wait_for_server, backoff)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sighup;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+    sigset_t hup_mask;
+    sigemptyset(&hup_mask);
+    sigaddset(&hup_mask, SIGHUP);
+    sigprocmask(SIG_BLOCK, &hup_mask, &wait_mask);
+
+    char buffer[config.buffer_size];
+    memset(buffer, 0, sizeof(buffer));
+
+    // --- Inicjalizacja połączenia ---
+    if (config.use_unix) {
+        if (config.unix_socket[0] == '\0') {
+            snprintf(config.unix_socket, sizeof(config.unix_socket), UNIX_SOCKET_PATH_FMT, config.port);
+        }
+        client_fd = connect_unix(config.unix_socket);
+    } else {
+        client_fd = connect_tcp(config.port);
+    }
+    if (client_fd < 0) {
         exit(EXIT_FAILURE);
     }
     printf("[WORKER] Połączono z serwerem. Rozpoczynam pracę.\n");
 
     // --- Główna pętla workera ---
+    // Worker utrzymuje potok wydzierżawionych zadań: prośba o kolejne zadania (GET_TASKS)
+    // jest wysyłana zanim potok się opróżni, więc odpowiedź serwera nadchodzi w trakcie
+    // wykonywania bieżącego zadania zamiast po nim.
     while (keep_running) {
-        // 1. Wysłanie żądania o nowe zadanie
-        if (send(client_fd, "GET_TASK\n", strlen("GET_TASK\n"), 0) < 0) {
-            perror("[WORKER] send GET_TASK failed");
-            keep_running = 0;
-            continue;
+        // 1. Uzupełnienie potoku do docelowego okna
+        int missing = desired_window() - queue_count - expected_tasks;
+        if (!request_in_flight && missing > 0) {
+            if (no_tasks_available && queue_count == 0) {
+                printf("[WORKER] Brak zadań w kolejce. Czekam %d sekundy przed kolejną prośbą...\n", config.no_task_backoff_sec);
+                backoff(config.no_task_backoff_sec);
+                no_tasks_available = 0;
+            }
+            char request[32];
+            snprintf(request, sizeof(request), "GET_TASKS %d\n", missing);
+            if (send(client_fd, request, strlen(request), 0) < 0) {
+                perror("[WORKER] send GET_TASKS failed");
+                keep_running = 0;
+                continue;
+            }
+            request_in_flight = 1;
+            request_sent_ms = now_ms();
+            printf("\n[WORKER] Poproszono o %d zadań (okno %d, śr. czas zadania %.1f ms, śr. RTT %.2f ms).\n",
+                   missing, desired_window(), avg_exec_ms, avg_rtt_ms);
         }
-        printf("\n[WORKER] Poproszono o zadanie.\n");
 
-        int waiting_for_task_response = 1; // Flaga pętli oczekiwania na odpowiedź serwera
-        while (waiting_for_task_response && keep_running) {
-            // 2. Odczyt odpowiedzi serwera
-            memset(buffer, 0, BUFFER_SIZE);
-            valread = read_line(client_fd, buffer, BUFFER_SIZE);
+        // 2. Odbiór odpowiedzi serwera: blokujący, gdy potok jest pusty,
+        //    w przeciwnym razie tylko linie, które już nadeszły
+        while (keep_running) {
+            int waiting = (queue_count == 0);
+            if (!waiting) {
+                if (wait_for_server(0) <= 0) {
+                    break; // Brak oczekujących danych - przejście do wykonywania zadań
+                }
+            } else if (!request_in_flight && expected_tasks == 0) {
+                break; // Nic nie nadejdzie (np. serwer nie ma zadań) - powrót do kroku 1
+            } else {
+                int ready = wait_for_server(-1);
+                if (ready < 0) {
+                    perror("[WORKER] ppoll failed");
+                    keep_running = 0;
+                    break;
+                }
+                if (ready == 0) {
+                    continue; // Przeładowanie po SIGHUP - dalsze oczekiwanie na odpowiedź
+                }
+            }
 
+            memset(buffer, 0, sizeof(buffer));
+            valread = read_line(client_fd, buffer, sizeof(buffer));
             if (valread <= 0) { // Serwer zamknął połączenie lub błąd odczytu
                 if (valread == 0) {
                     printf("[WORKER] Serwer rozłączył się. Zamykam.\n");
                 } else {
                     perror("[WORKER] read_line failed");
                 }
-                keep_running = 0; // Zakończenie głównej pętli
-                waiting_for_task_response = 0; // Zakończenie pętli wewnętrznej
-                continue; 
+                keep_running = 0;
+                break;
             }
-            
+
             // Usunięcie znaku nowej linii z końca
-            buffer[strcspn(buffer, "\n")] = 0; 
+            buffer[strcspn(buffer, "\n")] = 0;
             if (strlen(buffer) == 0) continue; // Ignorowanie pustych linii
 
             printf("[SERVER->WORKER] Odebrano: '%s'\n", buffer);
+            handle_server_line(buffer, waiting);
+        }
+        if (!keep_running || queue_count == 0) {
+            continue;
+        }
 
-            // --- Parsowanie odpowiedzi serwera ---
-            if (strncmp(buffer, "TASK ", 5) == 0) {
-                // Serwer przysłał zadanie
-                int task_id;
-                char description[256] = {0}; // Bufor na opis zadania
-
-                // Użycie %255[^\n] zapobiega przepełnieniu bufora description
-                if (sscanf(buffer, "TASK %d %255[^\n]", &task_id, description) == 2) {
-                    char task_result[BUFFER_SIZE];
-                    execute_task(task_id, description, task_result, BUFFER_SIZE); // Wykonanie zadania
-                    
-                    // Przygotowanie i wysłanie wyniku
-                    char response_msg[BUFFER_SIZE];
-                    snprintf(response_msg, BUFFER_SIZE, "RESULT %d %s\n", task_id, task_result);
-                    
-                    if (send(client_fd, response_msg, strlen(response_msg), 0) < 0) {
-                        perror("[WORKER] send RESULT failed");
-                        keep_running = 0; // Błąd wysyłania, zakończ
-                    } else {
-                        printf("[WORKER] Wysłano wynik zadania %d.\n", task_id);
-                    }
-                } else {
-                    printf("[WORKER] Błąd parsowania zadania: %s\n", buffer);
-                }
-                waiting_for_task_response = 0; // Otrzymano zadanie, wyjście z pętli oczekiwania
-            } else if (strncmp(buffer, "NO_TASK", 7) == 0) {
-                printf("[WORKER] Brak zadań w kolejce. Czekam 3 sekundy przed kolejną prośbą...\n");
-                sleep(3);
-                waiting_for_task_response = 0; // Brak zadania, wyjście z pętli oczekiwania
-            } else if (strncmp(buffer, "OK ", 3) == 0) { // Obsługa potwierdzeń (np. OK RESULT_RECEIVED)
-                printf("[WORKER] Otrzymano potwierdzenie od serwera: '%s'.\n", buffer);
-                // Potwierdzenie 'OK' nie kończy oczekiwania na główne polecenie (TASK/NO_TASK/ERROR).
-            }
-            else if (strncmp(buffer, "ERROR ", 6) == 0) { // Obsługa błędów od serwera
-                 printf("[WORKER] Serwer zwrócił błąd: '%s'. Czekam 3 sekundy...\n", buffer);
-                 sleep(3);
-                 waiting_for_task_response = 0; // Otrzymano błąd, wyjście z pętli oczekiwania
-            } else {
-                printf("[WORKER] Odebrano nieznaną odpowiedź od serwera: '%s'. Ignoruję.\n", buffer);
-                // Nieznana odpowiedź, worker kontynuuje oczekiwanie na TASK, NO_TASK lub ERROR.
-            }
-        } // koniec while (waiting_for_task_response)
+        // 3. Wykonanie zadania z początku potoku i odesłanie wyniku (bez czekania na potwierdzenie)
+        LeasedTask task = task_queue[queue_head];
+        queue_head = (queue_head + 1) % MAX_WINDOW;
+        queue_count--;
+
+        char task_result[config.buffer_size];
+        double exec_start_ms = now_ms();
+        current_task_id = task.id;
+        cancel_requested = 0;
+        int outcome = execute_task(task.id, task.description, task_result, sizeof(task_result)); // Wykonanie zadania
+        current_task_id = -1;
+        if (connection_closed) {
+            keep_running = 0;
+            continue;
+        }
+        if (outcome < 0) {
+            // Zadanie anulowane - serwer już zwolnił dzierżawę, wynik nie jest odsyłany
+            printf("[WORKER] Przerwano zadanie %d.\n", task.id);
+            continue;
+        }
+        update_ewma(&avg_exec_ms, now_ms() - exec_start_ms);
+
+        // Przygotowanie i wysłanie wyniku
+        char response_msg[config.buffer_size];
+        snprintf(response_msg, sizeof(response_msg), "RESULT %d %u %s\n", task.id, task.epoch, task_result);
+
+        if (send(client_fd, response_msg, strlen(response_msg), 0) < 0) {
+            perror("[WORKER] send RESULT failed");
+            keep_running = 0; // Błąd wysyłania, zakończ
+        } else {
+            printf("[WORKER] Wysłano wynik zadania %d.\n", task.id);
+        }
     } // koniec while (keep_running) - główna pętla workera
 
     close(client_fd);